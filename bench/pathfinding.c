@@ -0,0 +1,156 @@
+/**
+ * Measures pathfinding throughput on synthetic maps.
+ *
+ * Usage: pathfinding-bench [queries] [threads]
+ */
+#include "world/pathfinding.h"
+
+#include "common/array.h"
+#include "common/job.h"
+
+#include "husky.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define FLOW_FIELD_GOALS 8
+#define FLOW_FIELD_BUILDS 20
+
+static uint64_t g_rng = 0x9E3779B97F4A7C15ULL;
+
+static uint32_t rng_next() {
+        g_rng ^= g_rng << 13;
+        g_rng ^= g_rng >> 7;
+        g_rng ^= g_rng << 17;
+
+        return (uint32_t)(g_rng >> 32);
+}
+
+static double now_seconds() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+
+        return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Mixed terrain costs with scattered impassable blobs, roughly what a land map looks like
+static path_grid_t synthetic_grid(uint32_t size) {
+        path_grid_t grid = path_grid_create(size, size);
+
+        for (uint32_t tile = 0; tile < size * size; tile += 1) {
+                uint32_t r = rng_next() % 10;
+                path_grid_set_cost(&grid, tile, r < 7 ? 1 : (r < 9 ? 2 : 3));
+        }
+
+        uint32_t blobs = size * size / 150;
+        for (uint32_t b = 0; b < blobs; b += 1) {
+                uint32_t cx = rng_next() % size;
+                uint32_t cy = rng_next() % size;
+                uint32_t radius = 1 + rng_next() % 3;
+
+                for (uint32_t y = cy > radius ? cy - radius : 0; y <= cy + radius && y < size;
+                     y += 1) {
+                        for (uint32_t x = cx > radius ? cx - radius : 0;
+                             x <= cx + radius && x < size; x += 1) {
+                                path_grid_set_cost(&grid, y * size + x, PATH_COST_IMPASSABLE);
+                        }
+                }
+        }
+
+        return grid;
+}
+
+static uint32_t random_passable_tile(const path_grid_t *grid) {
+        for (;;) {
+                uint32_t x = rng_next() % grid->width;
+                uint32_t y = rng_next() % grid->height;
+                uint32_t cell = (y + 1) * grid->stride + x + 1;
+
+                if (grid->costs[cell] != PATH_COST_IMPASSABLE) {
+                        return y * grid->width + x;
+                }
+        }
+}
+
+static void bench_map(uint32_t size, uint32_t query_count) {
+        path_grid_t grid = synthetic_grid(size);
+
+        path_query_t *queries = calloc(query_count, sizeof(path_query_t));
+        uint32_t *serial_costs = malloc(query_count * sizeof(uint32_t));
+
+        for (uint32_t i = 0; i < query_count; i += 1) {
+                queries[i].start = random_passable_tile(&grid);
+                queries[i].goal = random_passable_tile(&grid);
+                queries[i].path = array(uint32_t);
+        }
+
+        // Single threaded A*
+        path_context_t ctx = path_context_create(&grid);
+        uint32_t *path = array(uint32_t);
+        uint64_t path_tiles = 0;
+        uint32_t unreachable = 0;
+
+        double start = now_seconds();
+        for (uint32_t i = 0; i < query_count; i += 1) {
+                serial_costs[i] = path_find(&ctx, &grid, queries[i].start, queries[i].goal, &path);
+                path_tiles += array_length(path);
+                unreachable += serial_costs[i] == PATH_NO_PATH;
+        }
+        double serial = now_seconds() - start;
+
+        // Batched A* on every worker
+        start = now_seconds();
+        path_find_batch(&grid, queries, query_count);
+        double batched = now_seconds() - start;
+
+        for (uint32_t i = 0; i < query_count; i += 1) {
+                ASSERT(queries[i].cost == serial_costs[i]);
+        }
+
+        // Flow field towards a handful of shared goals
+        flow_field_t field = flow_field_create(&grid);
+        uint32_t goals[FLOW_FIELD_GOALS];
+        for (uint32_t i = 0; i < FLOW_FIELD_GOALS; i += 1) {
+                goals[i] = random_passable_tile(&grid);
+        }
+
+        start = now_seconds();
+        for (uint32_t i = 0; i < FLOW_FIELD_BUILDS; i += 1) {
+                flow_field_build(&field, &ctx, &grid, goals, FLOW_FIELD_GOALS);
+        }
+        double flow = (now_seconds() - start) / FLOW_FIELD_BUILDS;
+
+        printf("%ux%u: %u queries, %u unreachable, %.1f tiles/path\n", size, size, query_count,
+               unreachable, (double)path_tiles / (query_count - unreachable + 1e-9));
+        printf("  astar serial   %10.0f queries/s\n", query_count / serial);
+        printf("  astar batched  %10.0f queries/s (%u workers)\n", query_count / batched,
+               jobs_worker_count());
+        printf("  flow field     %10.3f ms/build (%u goals)\n", flow * 1000.0, FLOW_FIELD_GOALS);
+
+        flow_field_destroy(&field);
+        array_free(path);
+        path_context_destroy(&ctx);
+
+        for (uint32_t i = 0; i < query_count; i += 1) {
+                array_free(queries[i].path);
+        }
+        free(queries);
+        free(serial_costs);
+        path_grid_destroy(&grid);
+}
+
+int main(int argc, char **argv) {
+        uint32_t query_count = argc > 1 ? (uint32_t)atoi(argv[1]) : 10000;
+        uint32_t threads = argc > 2 ? (uint32_t)atoi(argv[2]) : 0;
+
+        jobs_init(threads);
+
+        bench_map(128, query_count);
+        bench_map(512, query_count);
+
+        path_batch_shutdown();
+        jobs_shutdown();
+
+        return 0;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Hands out ids in [0, capacity), reusing released ids before new ones so they stay dense enough
+// to index fixed size tables. Not thread safe, callers guard it with their own lock.
+
+typedef struct id_allocator {
+        uint32_t *free_ids; // array, used as a stack
+        uint32_t next_id;   // ids from here on have never been handed out
+        uint32_t used;
+        uint32_t peak;
+        uint32_t capacity;
+} id_allocator_t;
+
+typedef struct id_allocator_stats {
+        uint32_t used;
+        uint32_t peak;
+        uint32_t capacity;
+} id_allocator_stats_t;
+
+id_allocator_t id_allocator_create(uint32_t capacity);
+void id_allocator_destroy(id_allocator_t *ids);
+
+// Asserts that an id is left
+uint32_t id_allocator_acquire(id_allocator_t *ids);
+void id_allocator_release(id_allocator_t *ids, uint32_t id);
+
+// True if `id` has been handed out at some point, it may have been released since
+bool id_allocator_issued(const id_allocator_t *ids, uint32_t id);
+
+id_allocator_stats_t id_allocator_stats(const id_allocator_t *ids);
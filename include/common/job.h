@@ -0,0 +1,17 @@
+#pragma once
+
+#include <stdint.h>
+
+// `worker` is in [0, jobs_worker_count()) and is stable for the duration of a call, so it can be
+// used to index per-thread scratch memory. The calling thread always runs as worker 0.
+typedef void (*job_fn_t)(void *data, uint32_t index, uint32_t worker);
+
+// Spawns `num_threads` worker threads, or one per core besides the calling thread if zero.
+void jobs_init(uint32_t num_threads);
+void jobs_shutdown();
+
+uint32_t jobs_worker_count();
+
+// Runs fn(data, i, worker) for every i in [0, count) and returns once all of them have finished.
+// Falls back to running serially on the calling thread if the job system is not initialized.
+void jobs_parallel_for(uint32_t count, job_fn_t fn, void *data);
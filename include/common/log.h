@@ -1,45 +1,43 @@
 #pragma once
 
-#include <stdio.h>
-#include <time.h>
+#include <stdint.h>
 
 #define LOG_LEVEL_DEBUG 0
 #define LOG_LEVEL_INFO 1
 #define LOG_LEVEL_ERROR 2
 
 #ifndef LOG_LEVEL
-#define LOG LEVEL LOG_LEVEL_DEBUG
+#define LOG_LEVEL LOG_LEVEL_DEBUG
 #endif
 
-#define LOG_TIMESTAMP(buf)                                                                         \
-        do {                                                                                       \
-                time_t _t = time(NULL);                                                            \
-                struct tm *_tm = localtime(&_t);                                                   \
-                strftime(buf, sizeof(buf), "%H:%M:%S", _tm);                                       \
-        } while (0)
-
-#define LOG_MESSAGE(level_str, stream, fmt, ...)                                                   \
-        do {                                                                                       \
-                char _ts[9];                                                                       \
-                LOG_TIMESTAMP(_ts);                                                                \
-                fprintf(stream, "[%s] [%s] (%s:%d) " fmt "\n", _ts, level_str, __FILE__, __LINE__, \
-                        ##__VA_ARGS__);                                                            \
-        } while (0)
+// Messages are formatted into a bounded lock-free queue and written to stdout by a background
+// thread, which is started by the first message and drained at exit. When the queue is full
+// messages are dropped and the count is reported once there is room again.
+#define LOG_QUEUE_SIZE 1024 // must be a power of two
+#define LOG_MESSAGE_SIZE 512
+
+void log_write(uint32_t level, const char *file, int line, const char *fmt, ...)
+    __attribute__((format(printf, 4, 5)));
+
+// Blocks until every message queued so far has been written
+void log_flush();
+
+#define LOG_MESSAGE(level, fmt, ...) log_write(level, __FILE__, __LINE__, fmt, ##__VA_ARGS__)
 
 #if LOG_LEVEL <= LOG_LEVEL_DEBUG
-#define DEBUG(fmt, ...) LOG_MESSAGE("DEBUG", stdout, fmt, ##__VA_ARGS__);
+#define DEBUG(fmt, ...) LOG_MESSAGE(LOG_LEVEL_DEBUG, fmt, ##__VA_ARGS__);
 #else
 #define DEBUG(FMT, ...) ((void)0)
 #endif
 
 #if LOG_LEVEL <= LOG_LEVEL_INFO
-#define INFO(fmt, ...) LOG_MESSAGE("INFO", stdout, fmt, ##__VA_ARGS__);
+#define INFO(fmt, ...) LOG_MESSAGE(LOG_LEVEL_INFO, fmt, ##__VA_ARGS__);
 #else
 #define INFO(FMT, ...) ((void)0)
 #endif
 
 #if LOG_LEVEL <= LOG_LEVEL_ERROR
-#define ERROR(fmt, ...) LOG_MESSAGE("ERROR", stdout, fmt, ##__VA_ARGS__);
+#define ERROR(fmt, ...) LOG_MESSAGE(LOG_LEVEL_ERROR, fmt, ##__VA_ARGS__);
 #else
 #define ERROR(FMT, ...) ((void)0)
 #endif
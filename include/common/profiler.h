@@ -0,0 +1,59 @@
+#pragma once
+
+#include <stdint.h>
+
+// Scoped CPU zones, recorded into a ring buffer per thread and exported as Chrome trace-event JSON
+// (load it in Perfetto or chrome://tracing). Everything compiles away unless HUSKY_PROFILE is
+// defined, see the CMake option of the same name.
+//
+//     void world_progress() {
+//             PROFILE_ZONE("world_progress");
+//             ...
+//     }
+//
+// Zone names must be string literals, or otherwise outlive the profiler.
+
+#define PROFILE_RING_SIZE 65536
+
+typedef struct profile_zone {
+        const char *name;
+        uint64_t begin;
+} profile_zone_t;
+
+profile_zone_t profile_zone_begin(const char *name);
+void profile_zone_end(profile_zone_t *zone);
+
+void profile_thread_name(const char *name);
+
+void profile_frame_begin();
+void profile_frame_end();
+
+// Writes every event still in the ring buffers. Threads must not record zones while this runs.
+void profile_write_trace(const char *path);
+// Frees every thread's ring buffer. Other threads must have stopped recording, e.g. been joined.
+void profile_shutdown();
+
+#ifdef HUSKY_PROFILE
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+
+#define PROFILE_ZONE(name)                                                                         \
+        profile_zone_t PROFILE_CONCAT(_profile_zone_, __LINE__)                                    \
+            __attribute__((cleanup(profile_zone_end))) = profile_zone_begin(name)
+#define PROFILE_THREAD(name) profile_thread_name(name)
+#define PROFILE_FRAME_BEGIN() profile_frame_begin()
+#define PROFILE_FRAME_END() profile_frame_end()
+#define PROFILE_WRITE_TRACE(path) profile_write_trace(path)
+#define PROFILE_SHUTDOWN() profile_shutdown()
+
+#else
+
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_THREAD(name) ((void)0)
+#define PROFILE_FRAME_BEGIN() ((void)0)
+#define PROFILE_FRAME_END() ((void)0)
+#define PROFILE_WRITE_TRACE(path) ((void)0)
+#define PROFILE_SHUTDOWN() ((void)0)
+
+#endif
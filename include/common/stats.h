@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// A growing list of samples, for summarizing benchmark runs
+
+typedef struct stats {
+        double *samples; // array
+        bool sorted;
+} stats_t;
+
+stats_t stats_create();
+void stats_destroy(stats_t *stats);
+
+void stats_add(stats_t *stats, double sample);
+
+uint32_t stats_count(const stats_t *stats);
+double stats_mean(const stats_t *stats);
+// Nearest-rank percentile, `p` in [0, 100]. Returns 0 when there are no samples.
+double stats_percentile(stats_t *stats, double p);
@@ -4,3 +4,7 @@
 #include <stdlib.h>
 
 char *ReadFile(const char *filename, size_t *filesize);
+
+// FNV-1a, chain calls by passing the previous result as `seed`
+#define HASH_SEED 0xcbf29ce484222325ULL
+uint64_t hash_bytes(const void *data, size_t size, uint64_t seed);
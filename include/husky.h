@@ -6,6 +6,7 @@
         do {                                                                                       \
                 if (!(x)) {                                                                        \
                         ERROR("ASSERT failed: %s", #x);                                            \
+                        log_flush();                                                               \
                         exit(1);                                                                   \
                 }                                                                                  \
         } while (0)
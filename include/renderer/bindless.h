@@ -0,0 +1,27 @@
+#pragma once
+
+#include "descriptors.h"
+#include "image.h"
+#include "vkb.h"
+
+#include "common/id_allocator.h"
+
+#include <stdint.h>
+
+// Every texture lives in one descriptor set shared by all frames, bound as set 1, and shaders
+// index it with the texture's slot. A texture is written once when added. Removed slots go back
+// on a free list through the deletion queue, once no frame in flight can sample them anymore.
+
+// Upper bound on the slots, the device limits can lower it further
+#define BINDLESS_MAX_TEXTURES 65536
+
+void bindless_init();
+void bindless_shutdown();
+
+DescriptorLayout *bindless_layout();
+Descriptor *bindless_descriptor();
+
+uint32_t bindless_texture_add(Image *image, VkSampler sampler);
+void bindless_texture_remove(uint32_t slot);
+
+id_allocator_stats_t bindless_stats();
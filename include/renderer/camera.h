@@ -2,6 +2,9 @@
 
 #include <cglm/cglm.h>
 
+#define CAMERA_NEAR 0.1f
+#define CAMERA_FAR 100.0f
+
 typedef struct camera {
         vec3 position;
         vec3 target;
@@ -11,3 +14,4 @@ typedef struct camera {
 } camera_t;
 
 void renderer_set_camera(camera_t camera);
+void renderer_camera_viewproj(mat4 dest);
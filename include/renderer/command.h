@@ -9,3 +9,17 @@ void immediate_command_shutdown();
 
 VkCommandBuffer immediate_command_begin();
 void immediate_command_end();
+
+// Secondary command buffers for recording on the job system. Every worker gets its own pool per
+// frame slot, so recording takes no locks, and a slot's pools are reset in one go once the GPU
+// is done with that frame.
+#define SECONDARY_COMMAND_MAX_FRAMES MAX_FRAMES_IN_FLIGHT
+
+void secondary_commands_init();
+void secondary_commands_shutdown();
+
+void secondary_commands_reset(uint32_t frame);
+// Begins a one time secondary command buffer from `worker`'s pool. `rendering` is the dynamic
+// rendering instance it continues, or NULL for commands recorded outside of one.
+VkCommandBuffer secondary_command_begin(uint32_t frame, uint32_t worker,
+                                        const VkCommandBufferInheritanceRenderingInfo *rendering);
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "buffer.h"
+#include "image.h"
+
+#include <stdint.h>
+
+// Resources the GPU may still be using are retired instead of destroyed. Everything retired
+// while a frame is recorded is tagged with the timeline value of that frame's submission, and
+// destroyed once the GPU has passed it, so freeing never has to wait for the device to go idle.
+// Retiring is safe from any thread.
+
+void deletion_queue_init();
+// Destroys everything still queued, the device must be idle
+void deletion_queue_shutdown();
+
+void deletion_queue_retire_buffer(buffer_t *buffer);
+void deletion_queue_retire_image(AllocatedImage *image);
+void deletion_queue_retire_pipeline(VkPipeline pipeline, VkPipelineLayout layout);
+// Anything else, e.g. returning a descriptor slot: calls `fn(handle)` once the GPU is done. `fn`
+// must not retire anything itself.
+void deletion_queue_retire(void (*fn)(uint64_t handle), uint64_t handle);
+
+// Tags everything retired since the last call with the timeline value of the submission that
+// was just made, the last one that can reference it
+void deletion_queue_seal(uint64_t value);
+// Destroys everything the GPU has finished with
+void deletion_queue_collect();
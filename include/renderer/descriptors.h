@@ -26,15 +26,20 @@ DescriptorLayout descriptor_layout_create(VkDevice device, DescriptorBinding *bi
                                           uint32_t count);
 void descriptor_layout_destroy(DescriptorLayout *layout);
 
-void descriptors_init();
+void descriptors_init(uint32_t frames_in_flight);
 void descriptors_shutdown();
 
+// Set 0 holds the scene UBO, the instance SSBO and the point lights, each bound with a dynamic
+// offset per frame, plus the material table and the light clusters
+#define GLOBAL_DYNAMIC_OFFSETS 3
+
 void global_descriptor_layout_init();
 DescriptorLayout *global_descriptor_layout();
 
 void descriptor_allocator_init(uint32_t num_frames);
 void descriptor_allocator_destroy();
 void descriptor_allocator_clear();
+// Only has an effect before descriptor_allocator_create, which descriptors_init calls
 void descriptor_allocator_reserve(DescriptorBinding *bindings, uint32_t count,
                                   bool per_frame_descriptor);
 
@@ -47,6 +52,8 @@ typedef struct {
 
 Descriptor descriptor_allocate(DescriptorLayout *layout);
 void descriptor_free(Descriptor *descriptor);
+// Frees the set once the frames recorded so far are done with it
+void descriptor_retire(Descriptor *descriptor);
 
 void descriptor_write_image(Descriptor descriptor, Image *image, uint32_t binding,
                             uint32_t arr_index);
@@ -54,3 +61,5 @@ void descriptor_write_texture(Descriptor descriptor, Image *image, uint32_t bind
                               uint32_t arr_index, VkSampler sampler);
 void descriptor_write_buffer(Descriptor descriptor, buffer_t *buffer, uint32_t binding,
                              uint32_t arr_index);
+void descriptor_write_buffer_range(Descriptor descriptor, buffer_t *buffer, uint32_t binding,
+                                   uint32_t arr_index, VkDeviceSize range);
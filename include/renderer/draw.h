@@ -1,8 +1,18 @@
 #pragma once
 
+#include "vkb.h"
+
+#include <stdint.h>
+
+// Draw batches recorded into one command buffer, when recording is split over several
+#define DRAW_BATCHES_PER_CHUNK 64
+
 void draw_buffers_init();
 void draw_buffers_shutdown();
 void draw_buffers_clear();
 
 void draw_batches_upload();
-void draw_batches_record();
+// Number of parts the batches are split into, at least one
+uint32_t draw_batches_chunk_count();
+// Records draws for one part of the batches, parts can be recorded in parallel
+void draw_batches_record(VkCommandBuffer cmd, uint32_t chunk, uint32_t chunk_count);
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// CPU side frame timing. In low latency mode a frame, and with it input sampling, starts as late
+// as the GPU allows: at most one frame is queued ahead of the GPU, and the CPU sleeps for however
+// much longer the GPU is expected to take than recording the next frame.
+
+#define FRAME_PACING_WINDOW 128 // frames the statistics are taken over
+
+typedef struct frame_pacing_stats {
+        double interval_ms;     // average time between frame starts
+        double interval_max_ms; // longest gap in the window, hitches show up here
+        double wait_ms;         // average time blocked on the GPU before a frame could start
+        double sleep_ms;        // average time slept by low latency pacing
+        double cpu_ms;          // average time from frame start to submit
+} frame_pacing_stats_t;
+
+void frame_pacing_init(bool low_latency);
+
+// Blocks until the next frame should start
+void frame_pacing_wait();
+// Call right before submitting, with the most recent GPU frame time or a negative value
+void frame_pacing_submit(double gpu_ms);
+
+frame_pacing_stats_t frame_pacing_stats();
@@ -4,8 +4,15 @@
 #include "vkb.h"
 
 // abstract gpu functions
-uint32_t gpu_upload_texture(material_info_t *mats);
+uint32_t gpu_upload_mesh(mesh_t *mesh);
+// Returns the texture's bindless slot. Uploading identical pixels again shares the texture and
+// takes another reference.
+uint32_t gpu_upload_texture(texture_data_t *texture);
 
+// Meshes are retired to the deletion queue, frames in flight can still use them, and their
+// indices aren't reused. Textures are retired once their last reference is released.
+void gpu_unload_mesh(uint32_t mesh);
+void gpu_unload_texture(uint32_t texture);
 void gpu_unload_models();
 
 VkBuffer gpu_mesh_index_buffer(uint32_t mesh);
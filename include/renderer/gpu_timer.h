@@ -0,0 +1,29 @@
+#pragma once
+
+#include "vkb.h"
+
+#include <stdint.h>
+
+// Timestamps around each frame's command buffer, and around scopes inside it such as render
+// passes. Results are read back once the frame's previous submission has finished, so reading
+// them never stalls.
+
+#define GPU_TIMER_MAX_FRAMES MAX_FRAMES_IN_FLIGHT
+#define GPU_TIMER_MAX_SCOPES 32
+
+void gpu_timer_init();
+void gpu_timer_shutdown();
+
+void gpu_timer_begin(VkCommandBuffer cmd, uint32_t frame);
+void gpu_timer_end(VkCommandBuffer cmd, uint32_t frame);
+
+// Scopes are numbered by the caller and recorded between gpu_timer_begin and gpu_timer_end
+void gpu_timer_scope_begin(VkCommandBuffer cmd, uint32_t frame, uint32_t scope);
+void gpu_timer_scope_end(VkCommandBuffer cmd, uint32_t frame, uint32_t scope);
+
+// Milliseconds between begin and end the last time `frame` was recorded, or a negative value if
+// there is no result yet
+double gpu_timer_read(uint32_t frame);
+// Fills `ms` with the duration of every scope up to the highest one recorded the last time
+// `frame` was, and returns how many that is. Zero if there are no results yet.
+uint32_t gpu_timer_read_scopes(uint32_t frame, double ms[GPU_TIMER_MAX_SCOPES]);
@@ -25,8 +25,23 @@ typedef struct {
 void image_create(ImageCreateInfo *info, Image *image);
 void image_destroy(Image *image, VkDevice device);
 
+// Accesses that have to be made available before an image is used again
+#define IMAGE_WRITE_ACCESS                                                                         \
+        (VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT |                                                  \
+         VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT |   \
+         VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT)
+
+// Stages and accesses of the operations an image in `layout` is used by. GENERAL can mean any of
+// them, so it is reported as all commands.
+void image_layout_scope(VkImageLayout layout, VkPipelineStageFlags2 *stages,
+                        VkAccessFlags2 *access);
+
 void image_transition(Image *image, VkCommandBuffer command, VkImageLayout layout);
 void image_blit(VkCommandBuffer command, Image *src, Image *dst);
+// Blits the top left `src_extent` of src onto the top left `dst_extent` of dst. The images must
+// already be in TRANSFER_SRC_OPTIMAL and TRANSFER_DST_OPTIMAL.
+void image_blit_region(VkCommandBuffer command, Image *src, VkExtent2D src_extent, Image *dst,
+                       VkExtent2D dst_extent);
 void image_buffer_copy(Image *dst, VkCommandBuffer cmd, VkBuffer buffer, VkExtent3D extent,
                        VkImageAspectFlags flags);
 
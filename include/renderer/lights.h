@@ -0,0 +1,26 @@
+#pragma once
+
+#include "vkb.h"
+
+#include <stdint.h>
+
+// Clustered forward lighting. The view frustum is split into a grid of froxels, tiles in screen
+// space and exponential slices in depth. Every frame the light cull pass bins the point lights
+// into the froxels they touch, and fragment shaders only loop over the lights of their own
+// froxel. The grid and light lists are bound at set 0 binding 4, see shaders/clusters.glsl,
+// which has to match the constants below.
+
+#define CLUSTER_X 16
+#define CLUSTER_Y 9
+#define CLUSTER_Z 24
+#define CLUSTER_COUNT (CLUSTER_X * CLUSTER_Y * CLUSTER_Z)
+// Lights past this in one froxel are dropped
+#define CLUSTER_MAX_LIGHTS 64
+
+// Needs the global descriptor set, call after swapchain_create()
+void lights_init();
+void lights_shutdown();
+
+void lights_clear();
+// Copies the lights recorded this frame into the frame's light buffer
+void lights_upload();
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "model.h"
+#include "vkb.h"
+
+#include "common/id_allocator.h"
+
+#include <stdint.h>
+
+// Materials live in one table on the GPU, bound at set 0 binding 2, and instances refer to them
+// by index. Identical materials share an entry, which is reference counted and, like its
+// textures, freed through the deletion queue once the last reference is released.
+
+#define MATERIAL_MAX 4096
+#define MATERIAL_NO_TEXTURE UINT32_MAX
+
+// Matches `Material` in shaders/input_structures.glsl
+typedef struct gpu_material {
+        vec4 base_color;
+        float metallic;
+        float roughness;
+        uint32_t textures[MATERIAL_TEXTURE_COUNT]; // bindless slots, or MATERIAL_NO_TEXTURE
+        uint32_t padding[3];
+} gpu_material_t;
+
+// Needs the global descriptor set, call after swapchain_create()
+void material_table_init();
+void material_table_shutdown();
+
+// Takes over the references to the material's textures. If an identical material exists it is
+// shared and the duplicate texture references are released.
+uint32_t material_create(const gpu_material_t *material);
+void material_retain(uint32_t material);
+void material_release(uint32_t material);
+
+id_allocator_stats_t material_stats();
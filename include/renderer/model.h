@@ -21,13 +21,25 @@ typedef struct mesh {
         uint32_t material_index;
 } mesh_t;
 
+typedef struct texture_data {
+        char *pixels; // RGBA8, NULL if the material has no such map
+        size_t width;
+        size_t height;
+} texture_data_t;
+
+typedef enum material_texture {
+        MATERIAL_TEXTURE_BASE_COLOR,
+        MATERIAL_TEXTURE_NORMAL,
+        MATERIAL_TEXTURE_METAL_ROUGHNESS,
+        MATERIAL_TEXTURE_COUNT,
+} material_texture_t;
+
 typedef struct material_info {
-        vec3 ambient;
-        vec3 specular;
+        vec4 base_color;
+        float metallic;
+        float roughness;
 
-        char *diffuse_tex;
-        size_t diffuse_width;
-        size_t diffuse_height;
+        texture_data_t textures[MATERIAL_TEXTURE_COUNT];
 } material_info_t;
 
 typedef struct model {
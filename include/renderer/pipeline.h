@@ -63,3 +63,20 @@ typedef struct compute_pipeline {
 
 compute_pipeline_t compute_pipeline_create(VkDevice device, comnpute_pipeline_config_t *info);
 void compute_pipeline_destroy(compute_pipeline_t *p, VkDevice device);
+
+///////////////////////////////////////
+/// Pipeline Builds
+///////////////////////////////////////
+
+#define PIPELINE_BUILD_MAX_DESCRIPTORS 4
+#define PIPELINE_BUILD_MAX_PUSH_CONSTANTS 4
+
+// Queued pipelines are compiled concurrently on the job system by pipelines_build, which writes
+// each result to `out` before returning. The config's arrays are copied, shader names and `out`
+// must stay valid until the build. Shaders are looked up by name, see shaders.h.
+void pipeline_queue_graphics(const graphics_pipeline_config_t *config, const char *vertex_shader,
+                             const char *fragment_shader, graphics_pipeline_t *out);
+void pipeline_queue_compute(const comnpute_pipeline_config_t *config, const char *shader,
+                            compute_pipeline_t *out);
+
+void pipelines_build();
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "vkb.h"
+
+// Process-wide VkPipelineCache used by every pipeline created through pipeline.h. The cache is
+// loaded from `path` if the file was written by the same device and driver, and written back
+// (via a temporary file and rename) at shutdown.
+
+void pipeline_cache_init(const char *path);
+void pipeline_cache_shutdown();
+
+VkPipelineCache pipeline_cache();
@@ -4,9 +4,13 @@
 
 #include <SDL3/SDL.h>
 
-void platform_init(uint32_t width, uint32_t height, const char *title);
+void platform_init(uint32_t width, uint32_t height, const char *title, bool headless);
 void platform_shutdown(void);
 
+bool platform_headless();
+// Instance extensions needed to create a surface, none when headless
+const char *const *platform_instance_extensions(uint32_t *count);
+
 VkSurfaceKHR platform_create_surface(VkInstance instance);
 
 void platform_get_size(uint32_t *width, uint32_t *height);
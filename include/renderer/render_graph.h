@@ -1,21 +1,75 @@
 #pragma once
 
+#include "gpu_timer.h"
 #include "image.h"
 
+#include <stdbool.h>
 #include <stdint.h>
 
 #define MAX_ATTACHMENTS 32
 #define MAX_PASSES 32
 
+// Number of frames the per-pass GPU time averages are taken over
+#define RENDER_GRAPH_TIMING_WINDOW 64
+
 typedef uint32_t attachment_handle_t;
 #define ATTACHMENT_BACKBUFFER UINT32_MAX // swapchain image
 
+typedef enum render_attachment_flags {
+        // Contents don't have to survive from one frame to the next. Transient attachments are
+        // discarded on first use and may share memory with others whose passes don't overlap.
+        RENDER_ATTACHMENT_TRANSIENT = 1 << 0,
+} render_attachment_flags_t;
+
+// Images are created when the graph is compiled, once every pass that uses them is known, and
+// recreated whenever the graph is resized
 typedef struct render_attachment {
         AllocatedImage image;
+
+        float scale; // of the graph's extent
+        VkExtent3D extent;
+        VkFormat format;
+        VkImageAspectFlags aspect;
+        VkImageUsageFlags usage;
+        uint32_t flags;
+
+        // Passes that use the attachment, first_pass > last_pass if none do
+        uint32_t first_pass;
+        uint32_t last_pass;
+
+        int32_t block; // index into the graph's memory blocks, -1 for a dedicated allocation
+        bool lazy;     // lazily allocated memory, only ever touched by one pass
+        VkDeviceSize size;
 } render_attachment_t;
 
+// Memory shared by transient attachments with disjoint lifetimes
+typedef struct render_memory_block {
+        VmaAllocation allocation;
+        VkDeviceSize size;
+        uint32_t memory_types; // bits every attachment placed in the block accepts
+} render_memory_block_t;
+
+typedef struct render_graph_memory {
+        VkDeviceSize requested; // every attachment in its own allocation
+        VkDeviceSize allocated; // after aliasing, lazily allocated attachments not counted
+        uint32_t block_count;
+        uint32_t lazy_count;
+} render_graph_memory_t;
+
+// The layout a pass declares for an attachment also says how the pass uses it, see
+// image_layout_scope. GENERAL means a storage image read and written by compute shaders.
+//
+// `record` runs on the job system and records into a secondary command buffer, which already has
+// the viewport and scissor set inside rendering passes. Recording happens before the pass's
+// barriers are in the frame's command buffer, so it can't rely on image layouts. Passes with a
+// `chunk_count` callback have their commands, e.g. a long draw list, split over that many
+// buffers recorded in parallel.
 typedef struct render_pass {
-        void (*record)(VkCommandBuffer);
+        const char *name;
+
+        void (*record)(VkCommandBuffer cmd, uint32_t chunk, uint32_t chunk_count);
+        uint32_t (*chunk_count)(void); // optional, one chunk if missing
+        void (*setup)(void); // optional, called once attachments exist, e.g. to write descriptors
         void (*cleanup)(void);
 
         attachment_handle_t attachments[8];
@@ -23,17 +77,84 @@ typedef struct render_pass {
         uint32_t attachment_count;
 } render_pass_t;
 
+// Barrier in front of a pass for one of its attachments, derived from the previous pass that
+// used the attachment. The first use in a frame waits on the last use of the previous frame.
+typedef struct render_barrier {
+        attachment_handle_t attachment;
+        VkImageLayout layout;
+        bool discard; // contents aren't needed, transition from UNDEFINED
+
+        VkPipelineStageFlags2 src_stages;
+        VkAccessFlags2 src_access;
+        VkPipelineStageFlags2 dst_stages;
+        VkAccessFlags2 dst_access;
+} render_barrier_t;
+
+// Built once after passes are registered, execution only resolves images and records them
+typedef struct render_graph_plan {
+        render_barrier_t barriers[MAX_PASSES][8];
+        uint32_t barrier_counts[MAX_PASSES];
+
+        bool clear_depth[MAX_PASSES]; // the pass is the first to render into its depth attachment
+        bool store_depth[MAX_PASSES]; // a later pass, or the next frame, reads the depth
+        bool compiled;
+} render_graph_plan_t;
+
+// Every pass is a gpu_timer scope, numbered by its index. A frame's results are read when the
+// graph next executes in the same frame slot, once the GPU has finished the slot's previous
+// submission, so collecting them never stalls.
+typedef struct render_graph_timing {
+        double samples[MAX_PASSES][RENDER_GRAPH_TIMING_WINDOW]; // milliseconds
+        double sums[MAX_PASSES];
+        uint32_t sample_count;
+        uint32_t next_sample;
+
+        uint32_t log_interval; // frames, zero disables logging
+        uint32_t frames_since_log;
+} render_graph_timing_t;
+
+typedef struct render_job {
+        uint32_t pass;
+        uint32_t chunk;
+        uint32_t chunk_count;
+} render_job_t;
+
+// Secondary command buffers of the frame being recorded, in pass order
+typedef struct render_graph_recording {
+        render_job_t *jobs;        // array
+        VkCommandBuffer *commands; // array, one per job
+        uint32_t first_job[MAX_PASSES + 1];
+        uint32_t frame;
+} render_graph_recording_t;
+
 typedef struct render_graph {
         render_attachment_t attachments[MAX_ATTACHMENTS];
         uint32_t attachment_count;
 
+        VkExtent2D extent;  // output size, attachment sizes are relative to it
+        float render_scale; // fraction of each attachment passes render into, zero means all
+        render_memory_block_t blocks[MAX_ATTACHMENTS];
+        render_graph_memory_t memory;
+        bool allocated;
+
         render_pass_t render_passes[MAX_PASSES];
         uint32_t pass_count;
+
+        render_graph_plan_t plan;
+        render_graph_recording_t recording;
+
+        render_graph_timing_t timing;
 } render_graph_t;
 
-attachment_handle_t render_graph_add_attachment(render_graph_t *graph, VkExtent3D extent,
-                                                VkFormat format, VkImageAspectFlags flags,
-                                                VkImageUsageFlags usage);
+typedef struct render_pass_timing {
+        const char *name;
+        double average_ms;
+} render_pass_timing_t;
+
+// `scale` sizes the attachment relative to the graph's extent, 1.0 is full output resolution
+attachment_handle_t render_graph_add_attachment(render_graph_t *graph, float scale,
+                                                VkFormat format, VkImageAspectFlags aspect,
+                                                VkImageUsageFlags usage, uint32_t flags);
 
 void render_graph_destroy(render_graph_t *graph);
 
@@ -42,4 +163,28 @@ Image *render_graph_attachment_image(render_graph_t *graph, attachment_handle_t
 
 void render_graph_register_pass(render_graph_t *graph, render_pass_t pass);
 
+// Allocates the attachments on first call, then derives the barriers between passes. Passes can't
+// be registered after the attachments are allocated. Called by render_graph_execute if needed.
+// Does nothing until the graph has a non-zero extent.
+void render_graph_compile(render_graph_t *graph);
+
+render_graph_memory_t render_graph_memory(render_graph_t *graph);
+
+// Recreates every attachment at its scale of `extent` and calls the passes' setup callbacks again
+// so descriptors point at the new images. The old images go to the deletion queue. A zero
+// extent, e.g. a minimized window, is ignored.
+void render_graph_resize(render_graph_t *graph, VkExtent2D extent);
+VkExtent2D render_graph_extent(render_graph_t *graph);
+
+// Passes render into the top left `scale` of every attachment, for dynamic resolution. Unlike a
+// resize this keeps the images, so it can change every frame.
+void render_graph_set_render_scale(render_graph_t *graph, float scale);
+// Area of the attachment rendered this frame, the full image for the backbuffer
+VkExtent2D render_graph_render_extent(render_graph_t *graph, attachment_handle_t attachment_ref);
+
 void render_graph_execute(render_graph_t *graph, VkCommandBuffer cmd);
+
+// Fills `timings` with one entry per pass, in execution order, and returns the number of passes
+uint32_t render_graph_pass_timings(render_graph_t *graph, render_pass_timing_t *timings);
+// Logs the average GPU time of every pass every `frames` frames, zero turns logging off
+void render_graph_set_timing_log(render_graph_t *graph, uint32_t frames);
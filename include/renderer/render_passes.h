@@ -3,5 +3,8 @@
 #include "render_graph.h"
 
 void gradient_pass_register(render_graph_t *graph, attachment_handle_t image);
+void light_cull_pass_register(render_graph_t *graph);
+void terrain_pass_register(render_graph_t *graph, attachment_handle_t hdr,
+                           attachment_handle_t depth);
 void pbr_pass_register(render_graph_t *graph, attachment_handle_t hdr, attachment_handle_t depth);
 void present_pass_register(render_graph_t *graph, attachment_handle_t image);
@@ -1,27 +1,65 @@
 #pragma once
 
+#include "frame_pacing.h"
+
 #include <cglm/cglm.h>
 
 #include <stdbool.h>
 #include <stdint.h>
 
+typedef enum present_mode {
+        PRESENT_MODE_FIFO,         // vsync, always supported
+        PRESENT_MODE_FIFO_RELAXED, // vsync, but a late frame is shown right away and may tear
+        PRESENT_MODE_MAILBOX,      // vsync without blocking, newer frames replace queued ones
+        PRESENT_MODE_IMMEDIATE,    // no vsync, tears
+} present_mode_t;
+
 typedef struct renderer_config {
         uint32_t width;
         uint32_t height;
         const char *title;
         bool debug;
+        uint32_t frames_in_flight;   // zero uses NUM_FRAMES
+        present_mode_t present_mode; // falls back to FIFO if the surface doesn't support it
+        // Start frames as late as the GPU allows to cut input latency, see frame_pacing.h
+        bool low_latency;
+
+        // Render into offscreen images without a window, for benchmarks on machines without a
+        // display
+        bool headless;
+        // Frames the main loop runs for, zero runs until quit. Not read by the renderer itself.
+        uint32_t frame_count;
+
+        // Lowers the render resolution while the GPU frame time is above the target, zero keeps
+        // it fixed
+        float target_gpu_ms;
+        float min_render_scale;
 } renderer_config_t;
 
 bool renderer_init(renderer_config_t *config);
 void renderer_shutdown();
 
+// Blocks until the next frame can start. Optional, call it right before sampling input so the
+// input is as fresh as possible.
+void renderer_wait_frame();
+// While the window has no area, e.g. when minimized, frames are skipped: nothing is drawn and
+// renderer_end_frame sleeps briefly instead of submitting
 void renderer_begin_frame();
 void renderer_end_frame();
 
 void renderer_draw();
 
+// GPU time of the most recently completed frame in milliseconds, negative until one completes
+double renderer_gpu_frame_time();
+
+// Per render graph pass GPU time averages, see render_graph_pass_timings()
+typedef struct render_pass_timing render_pass_timing_t;
+uint32_t renderer_pass_timings(render_pass_timing_t *timings);
+
+frame_pacing_stats_t renderer_frame_pacing();
+
 typedef struct material {
-        uint32_t diffuse_tex;
+        uint32_t id; // entry in the material table, see material.h
 } material_t;
 
 typedef struct {
@@ -35,5 +73,9 @@ typedef struct {
 } GpuModel;
 
 GpuModel renderer_load_model(char *filename);
+// Safe while frames using the model are in flight, see deletion_queue.h
+void renderer_unload_model(GpuModel model);
 
 void renderable_record(GpuModel model, mat4 transform);
+// Lights are recorded every frame like renderables, see lights.h
+void point_light_record(vec3 position, float radius, vec3 color, float intensity);
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+
+// Picks the render scale from measured GPU frame times. GPU time is assumed to follow the pixel
+// count, i.e. the square of the scale. Within a band just under the target the scale is left
+// alone, so it doesn't oscillate from frame to frame.
+
+typedef struct resolution_controller {
+        float target_ms;
+        float min_scale;
+        float max_scale;
+
+        float scale;
+        double average_ms; // exponential moving average, zero until the first sample
+        uint32_t frames_since_change;
+} resolution_controller_t;
+
+resolution_controller_t resolution_controller_create(float target_ms, float min_scale,
+                                                     float max_scale);
+
+// Adds one frame's GPU time and returns the scale to render the next frames at
+float resolution_controller_update(resolution_controller_t *controller, double gpu_ms);
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// SPIR-V for every shader in shaders/, compiled and embedded into the binary at build time.
+// Shaders are looked up by source file name, e.g. "pbr.vert". Setting HUSKY_SHADER_DIR loads
+// "<dir>/<name>.spv" from disk instead, so shaders can be iterated on without relinking.
+
+#define SHADER_DIR_ENV "HUSKY_SHADER_DIR"
+
+typedef struct shader_code {
+        const uint32_t *code;
+        uint32_t size; // in words
+
+        bool owned; // loaded from disk
+} shader_code_t;
+
+shader_code_t shader_load(const char *name);
+void shader_release(shader_code_t *shader);
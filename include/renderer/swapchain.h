@@ -6,24 +6,43 @@
 
 #include <stdbool.h>
 
+// Stage that waits on the acquire semaphore, the first write to the swapchain image has to
+// depend on it
+#define SWAPCHAIN_ACQUIRE_STAGE VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT
+
 typedef enum {
         FRAME_BUFFER_CAMERA,
         FRAME_BUFFER_INSTANCES,
+        FRAME_BUFFER_LIGHTS,
 } frame_buffer_type_t;
 
-void swapchain_create();
+// Frame resources (command buffers, acquire semaphores, buffers and descriptors) exist once per
+// frame in flight and live until swapchain_destroy. Images and their present semaphores belong
+// to the swapchain and are replaced when it is recreated. `present_mode` is used if the surface
+// supports it, FIFO otherwise.
+void swapchain_create(uint32_t frames_in_flight, VkPresentModeKHR present_mode);
 void swapchain_destroy();
 void SwapchainRecreate();
 
+// Returns false if the swapchain is out of date, recreate it and try again
 bool swapchain_next_frame();
+// Waits until the frame submitted `age` frames ago has finished on the GPU, zero being the last
+// one submitted and swapchain_frame_count() - 1 the oldest in flight. Returns false if it had
+// finished already. Only valid between submitting a frame and starting the next.
+bool swapchain_wait_submitted(uint32_t age);
 
 void swapchain_current_frame_submit();
 void swapchain_current_frame_begin();
-Descriptor *swapchain_current_frame_global_descriptor();
+// The global set is shared by all frames, bind it with the current frame's dynamic offsets
+Descriptor *swapchain_global_descriptor();
+void swapchain_current_frame_global_offsets(uint32_t offsets[GLOBAL_DYNAMIC_OFFSETS]);
 void *swapchain_current_frame_get_buffer(frame_buffer_type_t buffer_type);
 void swapchain_current_frame_unmap_buffer(frame_buffer_type_t buffer_type);
 
 VkCommandBuffer swapchain_current_frame_command_buffer();
 Image *swapchain_current_image();
+VkExtent2D swapchain_extent();
+
+uint32_t swapchain_current_frame_index();
+uint32_t swapchain_frame_count(); // frames in flight
 
-void swapchain_descriptors_write_texture(Image *image, uint32_t arr_index, VkSampler sampler);
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "vkb.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// The terrain is split into square chunks of TERRAIN_CHUNK_SIZE x TERRAIN_CHUNK_SIZE tiles. Each
+// chunk is a single instanced draw of the shared hex mesh, with one instance per tile.
+#define TERRAIN_CHUNK_SIZE 32
+#define TERRAIN_CHUNK_TILES (TERRAIN_CHUNK_SIZE * TERRAIN_CHUNK_SIZE)
+
+#define TERRAIN_HEX_RADIUS 1.0f
+#define TERRAIN_HEIGHT_SCALE 0.25f
+
+// Layout matches `Tile` in shaders/terrain.vert
+typedef struct terrain_tile {
+        float height;
+        uint32_t biome_tex;
+        uint32_t owner_color; // RGBA8, alpha of zero means unowned
+        uint32_t coord;       // x | y << 16
+} terrain_tile_t;
+
+void terrain_init(uint32_t width, uint32_t height);
+void terrain_shutdown();
+
+uint32_t terrain_biome_create(vec4 color);
+void terrain_set_tile(uint32_t x, uint32_t y, float height, uint32_t biome_tex,
+                      uint32_t owner_color);
+
+// World space center of the top face of a tile, the same placement the terrain shader uses
+void terrain_tile_top(uint32_t x, uint32_t y, float height, vec3 dest);
+
+// Tiles not visible to any player in `mask` are darkened. Zero shows everything.
+void terrain_set_view_mask(uint32_t mask);
+
+void terrain_upload();
+void terrain_cull();
+uint32_t terrain_visible_chunks();
+
+void terrain_record(VkCommandBuffer cmd, VkPipelineLayout layout);
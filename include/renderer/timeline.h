@@ -0,0 +1,24 @@
+#pragma once
+
+#include "vkb.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Timeline semaphore of the graphics queue. Every submission signals the next value, so whether
+// the GPU has finished some work is a comparison against the semaphore's counter, and any
+// subsystem can keep the value of its last submission instead of a fence.
+
+#define TIMELINE_MAX_SIGNALS 4 // including the timeline itself
+
+void timeline_init();
+void timeline_shutdown();
+
+// Submits to the graphics queue, additionally signalling the timeline. Returns the value that is
+// reached once the submission completes.
+uint64_t timeline_submit(const VkSubmitInfo2 *submit);
+
+// Value of the most recent submission
+uint64_t timeline_submitted();
+bool timeline_reached(uint64_t value);
+void timeline_wait(uint64_t value);
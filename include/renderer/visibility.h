@@ -0,0 +1,27 @@
+#pragma once
+
+#include "descriptors.h"
+#include "vkb.h"
+
+#include "world/visibility.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// GPU version of visibility_compute(). The masks live in an R32_UINT storage image with one texel
+// per tile, which the terrain shader reads to darken tiles the viewing player can't see.
+
+void visibility_gpu_init();
+void visibility_gpu_shutdown();
+
+// Allocates the storage image and uploads the blocker bits. Must be called before compute.
+void visibility_gpu_set_map(uint32_t width, uint32_t height, const uint32_t *blockers);
+
+void visibility_gpu_compute(const visibility_source_t *sources, uint32_t count);
+// Copies the masks of the last compute into `masks`, one uint32_t per tile. Waits for the GPU, so
+// it is meant for debugging, see HUSKY_CHECK_VISIBILITY.
+void visibility_gpu_readback(uint32_t *masks);
+
+// Storage image at binding 0, usable from compute and vertex shaders
+DescriptorLayout *visibility_gpu_layout();
+Descriptor *visibility_gpu_descriptor();
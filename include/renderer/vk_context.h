@@ -2,7 +2,9 @@
 
 #include "vkb.h"
 
-void vk_context_init();
+#include <stdbool.h>
+
+void vk_context_init(bool validation);
 void vk_context_shutdown();
 
 void vk_context_wait_idle();
@@ -13,3 +15,4 @@ VkPhysicalDevice vk_context_physical_device();
 VkDevice vk_context_device();
 uint32_t vk_context_queue_family_index();
 VkQueue vk_context_graphics_queue();
+float vk_context_timestamp_period();
@@ -14,9 +14,12 @@
 #include <cglm/cglm.h>
 
 #define MAX_INSTANCES 100000
-#define MAX_TEXTURES 5000000
+#define MAX_LIGHTS 4096
 
+// Frames the CPU can record ahead of the GPU unless configured otherwise, independent of how
+// many images the swapchain has
 #define NUM_FRAMES 3
+#define MAX_FRAMES_IN_FLIGHT 8
 
 #define VK_EXPECT(x)                                                                               \
         do {                                                                                       \
@@ -35,11 +38,23 @@ typedef struct {
         vec4 ambientColor;
         vec4 sunlightDirection;
         vec4 sunlightColor;
+        vec4 clip; // x near plane, y far plane
 } SceneData;
 
 typedef struct {
         mat4 model;
         VkDeviceAddress vertex_address;
-        int tex_index;
-        int padding;
+        uint32_t material;
+        uint32_t padding;
 } Instance;
+
+typedef struct {
+        vec4 position; // w is the radius
+        vec4 color;    // w is the intensity
+} PointLight;
+
+typedef struct {
+        uint32_t count;
+        uint32_t padding[3];
+        PointLight lights[MAX_LIGHTS];
+} LightData;
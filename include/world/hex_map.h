@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Hex tiles are stored row-major in "odd-r" offset coordinates: pointy-top hexes where every odd
+// row is shoved right by half a tile.
+
+#define HEX_OWNER_NONE 0xFF
+
+typedef enum biome {
+        BIOME_OCEAN,
+        BIOME_COAST,
+        BIOME_GRASSLAND,
+        BIOME_PLAINS,
+        BIOME_DESERT,
+        BIOME_TUNDRA,
+        BIOME_MOUNTAIN,
+        BIOME_COUNT,
+} biome_t;
+
+typedef struct hex_tile {
+        uint8_t height;
+        uint8_t biome;
+        uint8_t owner;
+        uint8_t padding;
+} hex_tile_t;
+
+typedef struct hex_map {
+        uint32_t width;
+        uint32_t height;
+
+        hex_tile_t *tiles;
+} hex_map_t;
+
+hex_map_t hex_map_create(uint32_t width, uint32_t height);
+void hex_map_destroy(hex_map_t *map);
+
+void hex_map_generate(hex_map_t *map, uint32_t seed);
+
+hex_tile_t *hex_map_tile(hex_map_t *map, uint32_t x, uint32_t y);
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "world/hex_map.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Tiles are addressed by their index in the hex map, y * width + x. Movement costs are the cost of
+// entering a tile.
+
+#define PATH_COST_IMPASSABLE 0xFF
+#define PATH_NO_PATH UINT32_MAX
+#define FLOW_NO_DIRECTION 0xFF
+
+typedef struct path_grid {
+        uint32_t width;
+        uint32_t height;
+
+        // The grid is padded with a ring of impassable tiles, so that neighbors can be found by
+        // adding a precomputed offset without any bounds checks.
+        uint32_t stride;
+        uint8_t *costs;
+        int16_t *axial_q;
+        int16_t *axial_r;
+        int32_t neighbor_offsets[2][6]; // indexed by row parity
+
+        uint8_t min_cost;
+} path_grid_t;
+
+path_grid_t path_grid_create(uint32_t width, uint32_t height);
+void path_grid_destroy(path_grid_t *grid);
+
+void path_grid_set_cost(path_grid_t *grid, uint32_t tile, uint8_t cost);
+void path_grid_from_hex_map(path_grid_t *grid, const hex_map_t *map);
+
+uint32_t hex_distance(const path_grid_t *grid, uint32_t a, uint32_t b);
+
+// Scratch memory for a single search. Contexts are reused between queries and must not be shared
+// between threads.
+typedef struct path_context {
+        uint32_t capacity;
+        uint32_t *g;
+        uint32_t *parent;
+        uint32_t *stamp;
+        uint32_t generation;
+
+        struct path_heap_entry *heap;
+        uint32_t heap_length;
+        uint32_t heap_capacity;
+} path_context_t;
+
+path_context_t path_context_create(const path_grid_t *grid);
+void path_context_destroy(path_context_t *ctx);
+
+// A* search from `start` to `goal`. Returns the total cost or PATH_NO_PATH. If `path` is not NULL
+// it must be an array (see common/array.h); it is cleared and filled with the tiles from start to
+// goal, inclusive.
+uint32_t path_find(path_context_t *ctx, const path_grid_t *grid, uint32_t start, uint32_t goal,
+                   uint32_t **path);
+
+typedef struct path_query {
+        uint32_t start;
+        uint32_t goal;
+
+        uint32_t cost;
+        uint32_t *path; // optional, see path_find
+} path_query_t;
+
+// Runs every query on the job system, with one search context per worker.
+void path_find_batch(const path_grid_t *grid, path_query_t *queries, uint32_t count);
+void path_batch_shutdown();
+
+// Distance to the nearest goal for every tile, and the direction to step in to get there. Built
+// with a single multi-source Dijkstra, which is much cheaper than one A* per unit when many units
+// head for the same goals.
+typedef struct flow_field {
+        uint32_t *distance;
+        uint8_t *direction;
+} flow_field_t;
+
+flow_field_t flow_field_create(const path_grid_t *grid);
+void flow_field_destroy(flow_field_t *field);
+
+void flow_field_build(flow_field_t *field, path_context_t *ctx, const path_grid_t *grid,
+                      const uint32_t *goals, uint32_t goal_count);
+
+uint32_t flow_field_distance(const flow_field_t *field, const path_grid_t *grid, uint32_t tile);
+// Returns the next tile towards the nearest goal, or PATH_NO_PATH if the tile is a goal or can't
+// reach one.
+uint32_t flow_field_next(const flow_field_t *field, const path_grid_t *grid, uint32_t tile);
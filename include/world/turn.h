@@ -0,0 +1,84 @@
+#pragma once
+
+#include "world/hex_map.h"
+#include "world/pathfinding.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// End of turn processing runs in two phases. During the decision phase every AI player runs in
+// parallel against the game state, which nothing is allowed to modify, and records commands. The
+// apply phase then validates and applies those commands on a single thread, player by player in
+// index order. AI randomness comes from a generator seeded by (game seed, turn, player), so a
+// replay with the same seed produces the same state regardless of thread count or scheduling.
+
+#define TURN_MAX_PLAYERS 32
+#define UNIT_NONE UINT32_MAX
+
+typedef struct unit {
+        uint32_t tile;
+        uint8_t owner;
+        uint8_t moves; // movement points per turn
+        uint8_t sight;
+        uint8_t padding;
+} unit_t;
+
+typedef enum turn_command_type {
+        TURN_COMMAND_MOVE,
+        TURN_COMMAND_CLAIM,
+} turn_command_type_t;
+
+typedef struct turn_command {
+        turn_command_type_t type;
+        uint32_t unit;
+        uint32_t tile;
+} turn_command_t;
+
+typedef struct game_state {
+        uint64_t seed;
+        uint32_t turn;
+        uint32_t player_count;
+
+        hex_map_t *map;
+        path_grid_t grid;
+
+        unit_t *units;      // array
+        uint32_t *occupant; // unit index per tile, or UNIT_NONE
+
+        // Tiles whose ownership changed during the last turn, so the world can update the terrain
+        uint32_t *changed_tiles; // array
+} game_state_t;
+
+typedef struct turn_rng {
+        uint64_t state;
+} turn_rng_t;
+
+uint32_t turn_rng_next(turn_rng_t *rng);
+
+// Everything an AI sees and owns while deciding. Commands are appended to `commands`.
+typedef struct turn_ai {
+        const game_state_t *state;
+        uint32_t player;
+
+        turn_rng_t rng;
+        path_context_t *path;
+        uint32_t *path_tiles;     // array, scratch for path_find
+        turn_command_t *commands; // array
+} turn_ai_t;
+
+typedef void (*turn_ai_fn)(turn_ai_t *ai);
+
+void game_state_init(game_state_t *state, hex_map_t *map, uint32_t player_count, uint64_t seed);
+void game_state_destroy(game_state_t *state);
+
+uint32_t game_state_spawn_unit(game_state_t *state, uint32_t tile, uint8_t owner);
+
+// Runs the decision and apply phases for every player and advances the turn counter
+void turn_process(game_state_t *state, turn_ai_fn ai);
+void turn_shutdown();
+
+// Hash of the map and units, for checking that replays match bit for bit
+uint64_t game_state_hash(const game_state_t *state);
+
+// Sends units to random reachable tiles and claims the tiles they end up on
+void turn_ai_explore(turn_ai_t *ai);
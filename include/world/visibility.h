@@ -0,0 +1,32 @@
+#pragma once
+
+#include "world/hex_map.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Visibility is a bitmask per tile with bit n set when player n can see the tile. A unit sees every
+// tile within its sight radius, unless the line to the tile passes through a blocking tile. Lines
+// are traced with integer arithmetic only, so that shaders/visibility.comp produces the exact same
+// masks as the CPU version.
+
+#define VISIBILITY_MAX_SIGHT 7
+// Number of tiles within VISIBILITY_MAX_SIGHT of a unit, including its own
+#define VISIBILITY_WINDOW_TILES (3 * VISIBILITY_MAX_SIGHT * (VISIBILITY_MAX_SIGHT + 1) + 1)
+
+// Layout matches `Source` in shaders/visibility.comp
+typedef struct visibility_source {
+        uint16_t x;
+        uint16_t y;
+        uint8_t owner;
+        uint8_t sight;
+        uint8_t padding[2];
+} visibility_source_t;
+
+// One bit per tile, set for tiles that block line of sight
+uint32_t *visibility_blockers_create(const hex_map_t *map);
+void visibility_blockers_destroy(uint32_t *blockers);
+
+// Overwrites `masks`, which holds one uint32_t per tile
+void visibility_compute(uint32_t width, uint32_t height, const uint32_t *blockers,
+                        const visibility_source_t *sources, uint32_t count, uint32_t *masks);
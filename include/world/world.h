@@ -5,4 +5,10 @@
 
 void world_init();
 void world_progress();
+// Runs every AI player's turn and pushes ownership changes to the terrain
+void world_end_turn();
 void world_shutdown();
+
+// Replaces keyboard movement with a fixed camera path that advances once per frame, so that
+// benchmark runs render the same frames every time
+void world_set_camera_path(bool enabled);
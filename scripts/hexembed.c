@@ -2,15 +2,18 @@
  * A simple script to convert any string into a C file that can be embedded into
  * the application.
  *
- * Usage: hexembed <filename> <varname>
+ * Usage: hexembed <filename> <varname> [output]
+ *
+ * Writes to stdout unless an output file is given. The array is 4-byte aligned so
+ * SPIR-V can be handed to Vulkan directly.
  */
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 
 int main(int argc, char **argv) {
-        if (argc != 3) {
-                fprintf(stderr, "Usage: hexembed <filename> <varname>\n");
+        if (argc != 3 && argc != 4) {
+                fprintf(stderr, "Usage: hexembed <filename> <varname> [output]\n");
                 return 1;
         }
 
@@ -30,20 +33,33 @@ int main(int argc, char **argv) {
         fread(data, size, 1, f);
         fclose(f);
 
+        FILE *out = stdout;
+        if (argc == 4) {
+                out = fopen(argv[3], "w");
+                if (!out) {
+                        fprintf(stderr, "Failed to open output '%s'\n", argv[3]);
+                        return 1;
+                }
+        }
+
         const char *varname = argv[2];
-        printf("/* Contents of %s */\n", filename);
-        printf("#pragma once\n\n");
-        printf("#include <stddef.h>\n");
-        printf("#include <stdint.h>\n\n");
-        printf("const size_t %s_size = %ld;\n", varname, size);
-        printf("const uint8_t %s_file[] = {\n", varname);
+        fprintf(out, "/* Contents of %s */\n", filename);
+        fprintf(out, "#pragma once\n\n");
+        fprintf(out, "#include <stddef.h>\n");
+        fprintf(out, "#include <stdint.h>\n\n");
+        fprintf(out, "const size_t %s_size = %zu;\n", varname, size);
+        fprintf(out, "_Alignas(4) const uint8_t %s_file[] = {\n", varname);
 
         for (size_t i = 0; i < size; i += 1) {
-                printf("0x%02x%s", data[i],
-                       i == size - 1 ? "\n" : ((i + 1) % 16 == 0 ? ",\n" : ","));
+                fprintf(out, "0x%02x%s", data[i],
+                        i == size - 1 ? "\n" : ((i + 1) % 16 == 0 ? ",\n" : ","));
         }
 
-        printf("};\n");
+        fprintf(out, "};\n");
+
+        if (out != stdout) {
+                fclose(out);
+        }
 
         free(data);
         return 0;
@@ -0,0 +1,90 @@
+// Clustered point lights, see renderer/lights.h. Needs input_structures.glsl. The light cull
+// shader defines CLUSTER_WRITE to fill the clusters, everything else only reads them.
+
+// Must match include/renderer/lights.h
+#define CLUSTER_X 16
+#define CLUSTER_Y 9
+#define CLUSTER_Z 24
+#define CLUSTER_COUNT (CLUSTER_X * CLUSTER_Y * CLUSTER_Z)
+#define CLUSTER_MAX_LIGHTS 64
+#define MAX_LIGHTS 4096
+
+// Matches PointLight in include/renderer/vkb.h
+struct PointLight {
+  vec4 position; // w is the radius
+  vec4 color;    // w is the intensity
+};
+
+layout(std430, set = 0, binding = 3) readonly buffer LightBuffer {
+  uint count;
+  PointLight lights[];
+} light_buffer;
+
+#ifdef CLUSTER_WRITE
+#define CLUSTER_ACCESS
+#else
+#define CLUSTER_ACCESS readonly
+#endif
+
+layout(std430, set = 0, binding = 4) CLUSTER_ACCESS buffer ClusterBuffer {
+  uint counts[CLUSTER_COUNT];
+  uint indices[]; // CLUSTER_MAX_LIGHTS per cluster
+} cluster_buffer;
+
+// Froxels are screen tiles in normalized device coordinates, and depth slices that grow
+// exponentially from the near to the far plane. Both sides project with the same formula, so
+// they agree on the grid whichever way the projection flips the axes.
+vec2 cluster_ndc(vec3 view_position) {
+  float depth = max(-view_position.z, sceneData.clip.x);
+  return vec2(sceneData.proj[0][0], sceneData.proj[1][1]) * view_position.xy / depth;
+}
+
+uint cluster_slice(float depth) {
+  float near = sceneData.clip.x;
+  float far = sceneData.clip.y;
+  float slice = log(max(depth, near) / near) / log(far / near) * float(CLUSTER_Z);
+
+  return uint(clamp(slice, 0.0, float(CLUSTER_Z - 1)));
+}
+
+float cluster_slice_depth(uint slice) {
+  float near = sceneData.clip.x;
+  float far = sceneData.clip.y;
+
+  return near * pow(far / near, float(slice) / float(CLUSTER_Z));
+}
+
+uint cluster_index(vec3 view_position) {
+  vec2 tile = (cluster_ndc(view_position) * 0.5 + 0.5) * vec2(CLUSTER_X, CLUSTER_Y);
+  uvec2 xy = uvec2(clamp(tile, vec2(0.0), vec2(CLUSTER_X - 1, CLUSTER_Y - 1)));
+
+  return (cluster_slice(-view_position.z) * CLUSTER_Y + xy.y) * CLUSTER_X + xy.x;
+}
+
+// Windowed inverse square falloff, reaches zero at the radius
+float light_attenuation(float distance, float radius) {
+  float window = clamp(1.0 - pow(distance / radius, 4.0), 0.0, 1.0);
+
+  return window * window / (distance * distance + 1.0);
+}
+
+vec3 clustered_lights(vec3 world_position, vec3 normal, vec3 albedo) {
+  vec3 view_position = (sceneData.view * vec4(world_position, 1.0)).xyz;
+  uint cluster = cluster_index(view_position);
+  uint count = cluster_buffer.counts[cluster];
+
+  vec3 result = vec3(0.0);
+  for (uint i = 0; i < count; i++) {
+    uint index = cluster_buffer.indices[cluster * CLUSTER_MAX_LIGHTS + i];
+    PointLight light = light_buffer.lights[index];
+
+    vec3 to_light = light.position.xyz - world_position;
+    float distance = length(to_light);
+    float lambert = max(dot(normal, to_light / max(distance, 1e-4)), 0.0);
+
+    result += albedo * light.color.rgb * light.color.w * lambert *
+              light_attenuation(distance, light.position.w);
+  }
+
+  return result;
+}
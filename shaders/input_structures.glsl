@@ -1,5 +1,5 @@
 // set 0: global data
-// set 1: per-material data
+// set 1: bindless textures, indexed by slot (see renderer/bindless.h)
 
 layout(set = 0, binding = 0) uniform SceneData {
   mat4 view;
@@ -8,11 +8,22 @@ layout(set = 0, binding = 0) uniform SceneData {
   vec4 ambientColor;
   vec4 sunlightDirection; // w for sun power
   vec4 sunlightColor;
+  vec4 clip; // x near plane, y far plane
 } sceneData;
 
-// layout(set = 1, binding = 0) uniform GLTFMaterialData {
-//   vec4 colorFactors;
-//   vec4 metal_rough_factors;
-// } materialData;
+#define MATERIAL_TEXTURE_BASE_COLOR 0
+#define MATERIAL_TEXTURE_NORMAL 1
+#define MATERIAL_TEXTURE_METAL_ROUGHNESS 2
+#define MATERIAL_NO_TEXTURE 0xffffffffu
 
-// layout(set = 1, binding = 2) uniform sampler2D metalRoughTex;
+// See gpu_material_t in renderer/material.h
+struct Material {
+  vec4 base_color;
+  float metallic;
+  float roughness;
+  uint textures[3]; // bindless slots
+};
+
+layout(std430, set = 0, binding = 2) readonly buffer MaterialBuffer {
+  Material materials[];
+} material_buffer;
@@ -4,23 +4,34 @@
 #extension GL_EXT_nonuniform_qualifier : enable
 
 #include "input_structures.glsl"
+#include "clusters.glsl"
 
 layout(location = 0) in vec3 inColor;
 layout(location = 1) in vec3 inNormal;
 layout(location = 2) in vec2 inUV;
-layout(location = 3) flat in int inTexIndex;
+layout(location = 3) flat in uint inMaterial;
+layout(location = 4) in vec3 inWorldPosition;
 
 layout(location = 0) out vec4 fragColor;
 
-layout(set = 0, binding = 2) uniform sampler2D diffuse_textures[];
+layout(set = 1, binding = 0) uniform sampler2D diffuse_textures[];
 
 void main() {
   float light = max(dot(inNormal, sceneData.sunlightDirection.xyz), 0.1);
 
-  vec3 color = inColor * texture(diffuse_textures[nonuniformEXT(inTexIndex)], inUV).xyz;
+  Material material = material_buffer.materials[inMaterial];
+
+  vec4 base_color = material.base_color;
+  uint base_color_tex = material.textures[MATERIAL_TEXTURE_BASE_COLOR];
+  if (base_color_tex != MATERIAL_NO_TEXTURE) {
+    base_color *= texture(diffuse_textures[nonuniformEXT(base_color_tex)], inUV);
+  }
+
+  vec3 color = inColor * base_color.xyz;
   vec3 ambient = color * sceneData.ambientColor.xyz;
 
   // fragColor = vec4(color * light * sceneData.sunlightColor.w + ambient, 1.0f);
-  fragColor = vec4(ambient * light, 1.0f);
-  // fragColor = texture(diffuse_textures[nonuniformEXT(inTexIndex)], inUV);
+  vec3 local = clustered_lights(inWorldPosition, normalize(inNormal), color);
+
+  fragColor = vec4(ambient * light + local, 1.0f);
 }
@@ -8,7 +8,8 @@
 layout(location = 0) out vec3 outColor;
 layout(location = 1) out vec3 outNormal;
 layout(location = 2) out vec2 outUV;
-layout(location = 3) flat out int outTexIndex;
+layout(location = 3) flat out uint outMaterial;
+layout(location = 4) out vec3 outWorldPosition;
 
 struct Vertex {
   vec3 position;
@@ -25,8 +26,8 @@ layout(buffer_reference, std430) readonly buffer VertexBuffer {
 struct Instance {
   mat4 model;
   VertexBuffer vertex_buffer;
-  int tex_index;
-  int padding;
+  uint material;
+  uint padding;
 };
 
 layout(std430, set = 0, binding = 1) readonly buffer InstanceBuffer {
@@ -37,10 +38,15 @@ void main() {
   Instance i = instance_buffer.instances[gl_InstanceIndex];
   Vertex v = i.vertex_buffer.vertices[gl_VertexIndex];
 
-  gl_Position = sceneData.viewproj * i.model * vec4(v.position, 1.0f);
+  vec4 world_position = i.model * vec4(v.position, 1.0f);
+
+  gl_Position = sceneData.viewproj * world_position;
   outColor = v.color.xyz;
-  outNormal = v.normal;
+  // Inverse transpose, so non-uniform scale doesn't skew the normal
+  mat3 normal_matrix = transpose(inverse(mat3(i.model)));
+  outNormal = normalize(normal_matrix * v.normal);
   outUV.x = v.uv_x;
   outUV.y = v.uv_y;
-  outTexIndex = i.tex_index;
+  outMaterial = i.material;
+  outWorldPosition = world_position.xyz;
 }
@@ -0,0 +1,34 @@
+#version 450
+
+#extension GL_GOOGLE_include_directive : require
+#extension GL_EXT_nonuniform_qualifier : enable
+
+#include "input_structures.glsl"
+#include "clusters.glsl"
+
+layout(location = 0) in vec3 inColor;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec2 inUV;
+layout(location = 3) flat in int inTexIndex;
+layout(location = 4) flat in vec4 inOwnerColor;
+layout(location = 5) in float inRim;
+layout(location = 6) flat in float inVisible;
+layout(location = 7) in vec3 inWorldPosition;
+
+layout(location = 0) out vec4 fragColor;
+
+layout(set = 1, binding = 0) uniform sampler2D diffuse_textures[];
+
+void main() {
+  float light = max(dot(inNormal, normalize(sceneData.sunlightDirection.xyz)), 0.1);
+
+  vec3 color = inColor * texture(diffuse_textures[nonuniformEXT(inTexIndex)], inUV).xyz;
+
+  // owner borders fade in towards the rim of the tile
+  float border = smoothstep(0.8, 1.0, inRim) * inOwnerColor.a;
+  color = mix(color, inOwnerColor.rgb, border);
+
+  vec3 local = clustered_lights(inWorldPosition, normalize(inNormal), color);
+
+  fragColor = vec4((color * sceneData.ambientColor.xyz * light + local) * inVisible, 1.0f);
+}
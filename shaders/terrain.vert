@@ -0,0 +1,79 @@
+#version 450
+
+#extension GL_GOOGLE_include_directive : require
+#extension GL_EXT_buffer_reference : require
+
+#include "input_structures.glsl"
+
+layout(location = 0) out vec3 outColor;
+layout(location = 1) out vec3 outNormal;
+layout(location = 2) out vec2 outUV;
+layout(location = 3) flat out int outTexIndex;
+layout(location = 4) flat out vec4 outOwnerColor;
+layout(location = 5) out float outRim;
+layout(location = 6) flat out float outVisible;
+layout(location = 7) out vec3 outWorldPosition;
+
+struct Vertex {
+  vec3 position;
+  float uv_x;
+  vec3 normal;
+  float uv_y;
+  vec4 color;
+};
+
+layout(buffer_reference, std430) readonly buffer VertexBuffer {
+  Vertex vertices[];
+};
+
+// Matches terrain_tile_t in include/renderer/terrain.h
+struct Tile {
+  float height;
+  uint biome_tex;
+  uint owner_color;
+  uint coord;
+};
+
+layout(buffer_reference, std430) readonly buffer TileBuffer {
+  Tile tiles[];
+};
+
+layout(push_constant) uniform constants {
+  VertexBuffer vertex_buffer;
+  TileBuffer tile_buffer;
+  float hex_radius;
+  float height_scale;
+  float base_height;
+  uint view_mask;
+}
+PushConstants;
+
+// Bitmask of the players that can see each tile, see shaders/visibility.comp
+layout(r32ui, set = 2, binding = 0) uniform readonly uimage2D visibility;
+
+void main() {
+  Tile t = PushConstants.tile_buffer.tiles[gl_InstanceIndex];
+  Vertex v = PushConstants.vertex_buffer.vertices[gl_VertexIndex];
+
+  uint x = t.coord & 0xFFFF;
+  uint y = t.coord >> 16;
+
+  // odd-r offset layout: odd rows are shifted right by half a tile
+  vec3 center = vec3(sqrt(3.0) * PushConstants.hex_radius * (float(x) + 0.5 * float(y & 1)), 0.0,
+                     1.5 * PushConstants.hex_radius * float(y));
+
+  vec3 position = v.position * PushConstants.hex_radius;
+  position.y = v.position.y * (PushConstants.base_height + t.height * PushConstants.height_scale);
+
+  gl_Position = sceneData.viewproj * vec4(center + position, 1.0f);
+  outWorldPosition = center + position;
+  outColor = v.color.xyz;
+  outNormal = v.normal;
+  outUV = vec2(v.uv_x, v.uv_y);
+  outTexIndex = int(t.biome_tex);
+  outOwnerColor = unpackUnorm4x8(t.owner_color);
+  outRim = v.color.a;
+
+  uint seen = imageLoad(visibility, ivec2(x, y)).r & PushConstants.view_mask;
+  outVisible = (PushConstants.view_mask == 0 || seen != 0) ? 1.0 : 0.35;
+}
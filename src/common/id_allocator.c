@@ -0,0 +1,53 @@
+#include "common/id_allocator.h"
+
+#include "common/array.h"
+
+#include "husky.h"
+
+#include <stdlib.h>
+
+id_allocator_t id_allocator_create(uint32_t capacity) {
+        return (id_allocator_t){
+            .free_ids = array(uint32_t),
+            .capacity = capacity,
+        };
+}
+
+void id_allocator_destroy(id_allocator_t *ids) {
+        array_free(ids->free_ids);
+        *ids = (id_allocator_t){0};
+}
+
+uint32_t id_allocator_acquire(id_allocator_t *ids) {
+        uint32_t id;
+        if (array_length(ids->free_ids)) {
+                id = ids->free_ids[array_length(ids->free_ids) - 1];
+                array_header(ids->free_ids)->length -= 1;
+        } else {
+                ASSERT(ids->next_id < ids->capacity);
+                id = ids->next_id++;
+        }
+
+        ids->used += 1;
+        if (ids->used > ids->peak) {
+                ids->peak = ids->used;
+        }
+
+        return id;
+}
+
+void id_allocator_release(id_allocator_t *ids, uint32_t id) {
+        ASSERT(id_allocator_issued(ids, id));
+        array_append(ids->free_ids, id);
+        ids->used -= 1;
+}
+
+bool id_allocator_issued(const id_allocator_t *ids, uint32_t id) { return id < ids->next_id; }
+
+id_allocator_stats_t id_allocator_stats(const id_allocator_t *ids) {
+        return (id_allocator_stats_t){
+            .used = ids->used,
+            .peak = ids->peak,
+            .capacity = ids->capacity,
+        };
+}
@@ -0,0 +1,194 @@
+#include "common/job.h"
+
+#include "common/profiler.h"
+
+#include "husky.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+// Written by the submitter under `lock`, every thread runs from its own copy
+typedef struct job_batch {
+        job_fn_t fn;
+        void *data;
+        uint32_t count;
+        uint32_t generation;
+} job_batch_t;
+
+typedef struct job_worker {
+        pthread_t thread;
+        uint32_t index;
+} job_worker_t;
+
+typedef struct job_system {
+        job_worker_t *workers;
+        uint32_t worker_count;
+
+        // Only one batch runs at a time, callers from different threads queue up here
+        pthread_mutex_t submit_lock;
+
+        pthread_mutex_t lock;
+        pthread_cond_t wake;
+        pthread_cond_t finished;
+
+        job_batch_t batch;
+        // The batch's generation in the high 32 bits and the next index to claim in the low 32, so
+        // a worker that wakes up late can't claim an index of a newer batch
+        atomic_uint_fast64_t next;
+        atomic_uint done;
+        bool quit;
+} job_system_t;
+
+static job_system_t g_jobs;
+
+static bool batch_claim(const job_batch_t *batch, uint32_t *index) {
+        uint64_t next = atomic_load(&g_jobs.next);
+        do {
+                if ((uint32_t)(next >> 32) != batch->generation || (uint32_t)next >= batch->count) {
+                        return false;
+                }
+        } while (!atomic_compare_exchange_weak(&g_jobs.next, &next, next + 1));
+
+        *index = (uint32_t)next;
+        return true;
+}
+
+static void batch_run(const job_batch_t *batch, uint32_t worker) {
+        uint32_t i;
+        while (batch_claim(batch, &i)) {
+                batch->fn(batch->data, i, worker);
+
+                if (atomic_fetch_add(&g_jobs.done, 1) + 1 == batch->count) {
+                        pthread_mutex_lock(&g_jobs.lock);
+                        pthread_cond_signal(&g_jobs.finished);
+                        pthread_mutex_unlock(&g_jobs.lock);
+                }
+        }
+}
+
+static void *worker_main(void *arg) {
+        job_worker_t *worker = arg;
+        uint32_t seen = 0;
+
+        PROFILE_THREAD("worker");
+
+        pthread_mutex_lock(&g_jobs.lock);
+        for (;;) {
+                while (!g_jobs.quit && g_jobs.batch.generation == seen) {
+                        pthread_cond_wait(&g_jobs.wake, &g_jobs.lock);
+                }
+
+                if (g_jobs.quit) {
+                        break;
+                }
+
+                // The submitter may move on to the next batch while this one still runs, so only
+                // the copy is read outside the lock
+                job_batch_t batch = g_jobs.batch;
+                seen = batch.generation;
+                pthread_mutex_unlock(&g_jobs.lock);
+
+                batch_run(&batch, worker->index);
+
+                pthread_mutex_lock(&g_jobs.lock);
+        }
+        pthread_mutex_unlock(&g_jobs.lock);
+
+        return NULL;
+}
+
+void jobs_init(uint32_t num_threads) {
+        if (num_threads == 0) {
+                long cores = sysconf(_SC_NPROCESSORS_ONLN);
+                num_threads = cores > 1 ? (uint32_t)cores - 1 : 0;
+        }
+
+        pthread_mutex_init(&g_jobs.submit_lock, NULL);
+        pthread_mutex_init(&g_jobs.lock, NULL);
+        pthread_cond_init(&g_jobs.wake, NULL);
+        pthread_cond_init(&g_jobs.finished, NULL);
+
+        g_jobs.quit = false;
+        g_jobs.batch = (job_batch_t){0};
+        atomic_store(&g_jobs.next, 0);
+        atomic_store(&g_jobs.done, 0);
+        g_jobs.worker_count = num_threads;
+        g_jobs.workers = calloc(num_threads, sizeof(job_worker_t));
+
+        for (uint32_t i = 0; i < num_threads; i += 1) {
+                g_jobs.workers[i].index = i + 1;
+                ASSERT(pthread_create(&g_jobs.workers[i].thread, NULL, worker_main,
+                                      &g_jobs.workers[i]) == 0);
+        }
+
+        DEBUG("job system: %u worker threads", num_threads);
+}
+
+void jobs_shutdown() {
+        if (!g_jobs.workers) {
+                return;
+        }
+
+        pthread_mutex_lock(&g_jobs.lock);
+        g_jobs.quit = true;
+        pthread_cond_broadcast(&g_jobs.wake);
+        pthread_mutex_unlock(&g_jobs.lock);
+
+        for (uint32_t i = 0; i < g_jobs.worker_count; i += 1) {
+                pthread_join(g_jobs.workers[i].thread, NULL);
+        }
+
+        free(g_jobs.workers);
+        g_jobs.workers = NULL;
+        g_jobs.worker_count = 0;
+
+        pthread_cond_destroy(&g_jobs.finished);
+        pthread_cond_destroy(&g_jobs.wake);
+        pthread_mutex_destroy(&g_jobs.lock);
+        pthread_mutex_destroy(&g_jobs.submit_lock);
+}
+
+uint32_t jobs_worker_count() { return g_jobs.worker_count + 1; }
+
+void jobs_parallel_for(uint32_t count, job_fn_t fn, void *data) {
+        if (count == 0) {
+                return;
+        }
+
+        if (!g_jobs.workers || count == 1) {
+                for (uint32_t i = 0; i < count; i += 1) {
+                        fn(data, i, 0);
+                }
+                return;
+        }
+
+        pthread_mutex_lock(&g_jobs.submit_lock);
+
+        pthread_mutex_lock(&g_jobs.lock);
+        job_batch_t batch = {
+            .fn = fn,
+            .data = data,
+            .count = count,
+            .generation = g_jobs.batch.generation + 1,
+        };
+        g_jobs.batch = batch;
+        atomic_store(&g_jobs.done, 0);
+        atomic_store(&g_jobs.next, (uint64_t)batch.generation << 32);
+        pthread_cond_broadcast(&g_jobs.wake);
+        pthread_mutex_unlock(&g_jobs.lock);
+
+        batch_run(&batch, 0);
+
+        // Workers only touch `done` for indices they claimed, so once every job has finished the
+        // next batch can reset it, even if some workers haven't left this one yet
+        pthread_mutex_lock(&g_jobs.lock);
+        while (atomic_load(&g_jobs.done) < count) {
+                pthread_cond_wait(&g_jobs.finished, &g_jobs.lock);
+        }
+        pthread_mutex_unlock(&g_jobs.lock);
+
+        pthread_mutex_unlock(&g_jobs.submit_lock);
+}
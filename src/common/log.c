@@ -0,0 +1,221 @@
+#include "common/log.h"
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Bounded MPSC queue: each slot's sequence number tells producers when it is free and the
+// writer thread when it has been published, so neither side takes a lock
+typedef struct log_slot {
+        atomic_size_t sequence;
+
+        uint32_t level;
+        int line;
+        const char *file;
+        uint64_t time;
+        char text[LOG_MESSAGE_SIZE];
+} log_slot_t;
+
+typedef struct log_queue {
+        log_slot_t slots[LOG_QUEUE_SIZE];
+        atomic_size_t enqueue;
+        atomic_size_t written; // slots consumed by the writer thread
+
+        atomic_uint_fast64_t dropped;
+
+        pthread_once_t once;
+        pthread_t thread;
+        sem_t pending;
+        atomic_bool sleeping; // the writer thread is parked on `pending`
+        atomic_bool quit;
+        atomic_bool running;
+
+        uint64_t epoch;
+} log_queue_t;
+
+static log_queue_t g_log = {.once = PTHREAD_ONCE_INIT};
+
+static const char *g_level_names[] = {
+    [LOG_LEVEL_DEBUG] = "DEBUG",
+    [LOG_LEVEL_INFO] = "INFO",
+    [LOG_LEVEL_ERROR] = "ERROR",
+};
+
+static uint64_t log_now() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+
+        return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void log_print(uint32_t level, const char *file, int line, uint64_t time,
+                      const char *text) {
+        double seconds = (time - g_log.epoch) * 1e-9;
+        fprintf(stdout, "[%10.4f] [%s] (%s:%d) %s\n", seconds, g_level_names[level], file, line,
+                text);
+}
+
+static void log_report_dropped() {
+        uint64_t dropped = atomic_exchange(&g_log.dropped, 0);
+        if (dropped) {
+                fprintf(stdout, "[%10.4f] [ERROR] log queue full, dropped %llu messages\n",
+                        (log_now() - g_log.epoch) * 1e-9, (unsigned long long)dropped);
+        }
+}
+
+static bool log_published() {
+        size_t position = atomic_load(&g_log.written);
+        log_slot_t *slot = &g_log.slots[position & (LOG_QUEUE_SIZE - 1)];
+
+        return atomic_load(&slot->sequence) == position + 1;
+}
+
+// Only posts when the writer is parked, so busy producers don't pay for a syscall per message
+static void log_wake() {
+        atomic_thread_fence(memory_order_seq_cst);
+        if (atomic_exchange(&g_log.sleeping, false)) {
+                sem_post(&g_log.pending);
+        }
+}
+
+// Writes everything published so far, returns false if the queue was empty
+static bool log_drain() {
+        size_t position = atomic_load_explicit(&g_log.written, memory_order_relaxed);
+        bool wrote = false;
+
+        for (;;) {
+                log_slot_t *slot = &g_log.slots[position & (LOG_QUEUE_SIZE - 1)];
+                size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+                if (sequence != position + 1) {
+                        break;
+                }
+
+                log_print(slot->level, slot->file, slot->line, slot->time, slot->text);
+
+                atomic_store_explicit(&slot->sequence, position + LOG_QUEUE_SIZE,
+                                      memory_order_release);
+                position += 1;
+                atomic_store_explicit(&g_log.written, position, memory_order_release);
+                wrote = true;
+        }
+
+        log_report_dropped();
+        if (wrote) {
+                fflush(stdout);
+        }
+
+        return wrote;
+}
+
+static void *log_thread(void *arg) {
+        (void)arg;
+
+        while (!atomic_load(&g_log.quit)) {
+                while (log_drain()) {
+                }
+
+                // A message published before the flag was set would never wake us, so look again
+                atomic_store(&g_log.sleeping, true);
+                if (log_published() || atomic_load(&g_log.quit)) {
+                        atomic_store(&g_log.sleeping, false);
+                        continue;
+                }
+                sem_wait(&g_log.pending);
+        }
+
+        log_drain();
+        return NULL;
+}
+
+static void log_shutdown() {
+        // Anything logged from here on, e.g. by other atexit handlers, is written directly
+        atomic_store(&g_log.running, false);
+
+        atomic_store(&g_log.quit, true);
+        sem_post(&g_log.pending);
+        pthread_join(g_log.thread, NULL);
+}
+
+static void log_start() {
+        for (size_t i = 0; i < LOG_QUEUE_SIZE; i += 1) {
+                atomic_init(&g_log.slots[i].sequence, i);
+        }
+        g_log.epoch = log_now();
+        sem_init(&g_log.pending, 0, 0);
+
+        if (pthread_create(&g_log.thread, NULL, log_thread, NULL) != 0) {
+                return;
+        }
+        atomic_store(&g_log.running, true);
+        atexit(log_shutdown);
+}
+
+void log_write(uint32_t level, const char *file, int line, const char *fmt, ...) {
+        pthread_once(&g_log.once, log_start);
+
+        uint64_t time = log_now();
+        va_list args;
+
+        if (!atomic_load_explicit(&g_log.running, memory_order_acquire)) {
+                char text[LOG_MESSAGE_SIZE];
+                va_start(args, fmt);
+                vsnprintf(text, sizeof(text), fmt, args);
+                va_end(args);
+
+                log_print(level, file, line, time, text);
+                return;
+        }
+
+        size_t position = atomic_load_explicit(&g_log.enqueue, memory_order_relaxed);
+        log_slot_t *slot;
+        for (;;) {
+                slot = &g_log.slots[position & (LOG_QUEUE_SIZE - 1)];
+                size_t sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+                intptr_t diff = (intptr_t)sequence - (intptr_t)position;
+
+                if (diff == 0) {
+                        if (atomic_compare_exchange_weak_explicit(&g_log.enqueue, &position,
+                                                                  position + 1,
+                                                                  memory_order_relaxed,
+                                                                  memory_order_relaxed)) {
+                                break;
+                        }
+                } else if (diff < 0) {
+                        // The writer thread hasn't caught up, never block the caller
+                        atomic_fetch_add_explicit(&g_log.dropped, 1, memory_order_relaxed);
+                        return;
+                } else {
+                        position = atomic_load_explicit(&g_log.enqueue, memory_order_relaxed);
+                }
+        }
+
+        slot->level = level;
+        slot->file = file;
+        slot->line = line;
+        slot->time = time;
+
+        va_start(args, fmt);
+        vsnprintf(slot->text, sizeof(slot->text), fmt, args);
+        va_end(args);
+
+        atomic_store_explicit(&slot->sequence, position + 1, memory_order_release);
+        log_wake();
+}
+
+void log_flush() {
+        if (!atomic_load(&g_log.running)) {
+                fflush(stdout);
+                return;
+        }
+
+        size_t target = atomic_load(&g_log.enqueue);
+        while (atomic_load_explicit(&g_log.written, memory_order_acquire) < target) {
+                log_wake();
+                nanosleep(&(struct timespec){.tv_nsec = 100000}, NULL);
+        }
+}
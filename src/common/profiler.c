@@ -0,0 +1,154 @@
+#include "common/profiler.h"
+
+#include "common/array.h"
+
+#include "husky.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+typedef struct profile_event {
+        const char *name;
+        uint64_t begin;
+        uint64_t end;
+} profile_event_t;
+
+// Written only by its own thread. Once full, new events overwrite the oldest ones.
+typedef struct profile_thread {
+        profile_event_t events[PROFILE_RING_SIZE];
+        uint64_t count; // total events ever recorded
+
+        uint32_t id;
+        const char *name;
+} profile_thread_t;
+
+typedef struct profiler {
+        pthread_mutex_t lock;
+        profile_thread_t **threads; // array
+
+        uint64_t epoch; // start of the trace, taken when the first thread registers
+        uint64_t frame_begin;
+} profiler_t;
+
+static profiler_t g_profiler = {.lock = PTHREAD_MUTEX_INITIALIZER};
+static _Thread_local profile_thread_t *t_thread;
+
+static uint64_t profile_now() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+
+        return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static profile_thread_t *profile_thread() {
+        if (t_thread) {
+                return t_thread;
+        }
+
+        t_thread = calloc(1, sizeof(profile_thread_t));
+
+        pthread_mutex_lock(&g_profiler.lock);
+        if (!g_profiler.threads) {
+                g_profiler.threads = array(profile_thread_t *);
+                g_profiler.epoch = profile_now();
+        }
+        t_thread->id = array_length(g_profiler.threads);
+        array_append(g_profiler.threads, t_thread);
+        pthread_mutex_unlock(&g_profiler.lock);
+
+        return t_thread;
+}
+
+static void profile_record(const char *name, uint64_t begin, uint64_t end) {
+        profile_thread_t *thread = profile_thread();
+
+        thread->events[thread->count % PROFILE_RING_SIZE] = (profile_event_t){name, begin, end};
+        thread->count++;
+}
+
+profile_zone_t profile_zone_begin(const char *name) {
+        profile_thread();
+
+        return (profile_zone_t){
+            .name = name,
+            .begin = profile_now(),
+        };
+}
+
+void profile_zone_end(profile_zone_t *zone) {
+        profile_record(zone->name, zone->begin, profile_now());
+}
+
+void profile_thread_name(const char *name) { profile_thread()->name = name; }
+
+void profile_frame_begin() {
+        profile_thread();
+        g_profiler.frame_begin = profile_now();
+}
+
+void profile_frame_end() { profile_record("frame", g_profiler.frame_begin, profile_now()); }
+
+void profile_write_trace(const char *path) {
+        FILE *f = fopen(path, "w");
+        if (!f) {
+                ERROR("profiler: failed to open %s", path);
+                return;
+        }
+
+        pthread_mutex_lock(&g_profiler.lock);
+
+        fprintf(f, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+
+        uint64_t written = 0;
+        uint32_t thread_count = g_profiler.threads ? array_length(g_profiler.threads) : 0;
+        for (uint32_t t = 0; t < thread_count; t += 1) {
+                profile_thread_t *thread = g_profiler.threads[t];
+
+                if (thread->name) {
+                        fprintf(f,
+                                "%s{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": 1, "
+                                "\"tid\": %u, \"args\": {\"name\": \"%s\"}}",
+                                written++ ? ",\n" : "", thread->id, thread->name);
+                }
+
+                uint64_t first = thread->count > PROFILE_RING_SIZE
+                                     ? thread->count - PROFILE_RING_SIZE
+                                     : 0;
+                for (uint64_t e = first; e < thread->count; e += 1) {
+                        profile_event_t *event = &thread->events[e % PROFILE_RING_SIZE];
+
+                        // Trace timestamps and durations are in microseconds
+                        fprintf(f,
+                                "%s{\"ph\": \"X\", \"name\": \"%s\", \"pid\": 1, \"tid\": %u, "
+                                "\"ts\": %.3f, \"dur\": %.3f}",
+                                written++ ? ",\n" : "", event->name, thread->id,
+                                (event->begin - g_profiler.epoch) * 1e-3,
+                                (event->end - event->begin) * 1e-3);
+                }
+        }
+
+        fprintf(f, "\n]}\n");
+
+        pthread_mutex_unlock(&g_profiler.lock);
+        fclose(f);
+
+        INFO("profiler: wrote %llu events from %u threads to %s", (unsigned long long)written,
+             thread_count, path);
+}
+
+void profile_shutdown() {
+        pthread_mutex_lock(&g_profiler.lock);
+
+        if (g_profiler.threads) {
+                for (uint32_t t = 0; t < array_length(g_profiler.threads); t += 1) {
+                        free(g_profiler.threads[t]);
+                }
+                array_free(g_profiler.threads);
+                g_profiler.threads = NULL;
+        }
+        t_thread = NULL;
+
+        pthread_mutex_unlock(&g_profiler.lock);
+}
@@ -0,0 +1,60 @@
+#include "common/stats.h"
+
+#include "common/array.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+stats_t stats_create() {
+        return (stats_t){
+            .samples = array(double),
+            .sorted = true,
+        };
+}
+
+void stats_destroy(stats_t *stats) { array_free(stats->samples); }
+
+void stats_add(stats_t *stats, double sample) {
+        array_append(stats->samples, sample);
+        stats->sorted = false;
+}
+
+uint32_t stats_count(const stats_t *stats) { return array_length(stats->samples); }
+
+double stats_mean(const stats_t *stats) {
+        uint32_t count = array_length(stats->samples);
+        if (count == 0) {
+                return 0.0;
+        }
+
+        double sum = 0.0;
+        for (uint32_t i = 0; i < count; i += 1) {
+                sum += stats->samples[i];
+        }
+
+        return sum / count;
+}
+
+static int compare_doubles(const void *a, const void *b) {
+        double x = *(const double *)a;
+        double y = *(const double *)b;
+
+        return (x > y) - (x < y);
+}
+
+double stats_percentile(stats_t *stats, double p) {
+        uint32_t count = array_length(stats->samples);
+        if (count == 0) {
+                return 0.0;
+        }
+
+        if (!stats->sorted) {
+                qsort(stats->samples, count, sizeof(double), compare_doubles);
+                stats->sorted = true;
+        }
+
+        uint32_t rank = (uint32_t)ceil(p / 100.0 * count);
+        rank = rank < 1 ? 1 : (rank > count ? count : rank);
+
+        return stats->samples[rank - 1];
+}
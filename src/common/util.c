@@ -33,3 +33,14 @@ char *ReadFile(const char *filename, size_t *filesize) {
 
         return data;
 }
+
+uint64_t hash_bytes(const void *data, size_t size, uint64_t seed) {
+        const uint8_t *bytes = data;
+        uint64_t hash = seed;
+
+        for (size_t i = 0; i < size; i += 1) {
+                hash = (hash ^ bytes[i]) * 0x100000001b3ULL;
+        }
+
+        return hash;
+}
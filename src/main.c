@@ -1,8 +1,35 @@
+#include "common/job.h"
+#include "common/profiler.h"
+#include "common/stats.h"
+#include "renderer/bindless.h"
+#include "renderer/material.h"
+#include "renderer/render_graph.h"
 #include "renderer/renderer.h"
 #include "world/world.h"
 
+#include "husky.h"
+
 #include <SDL3/SDL.h>
 
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Frames rendered before measuring starts, so pipeline and allocation warm-up isn't counted
+#define BENCHMARK_WARMUP_FRAMES 30
+
+#define USAGE "usage: civ-game [--benchmark <frames> [output.json]]"
+
+typedef struct benchmark {
+        const char *output;
+
+        stats_t cpu;
+        stats_t gpu;
+        double elapsed;
+} benchmark_t;
+
 bool should_quit(SDL_Event *e) {
         return e->type == SDL_EVENT_QUIT ||
                (e->type == SDL_EVENT_KEY_DOWN && e->key.key == SDLK_ESCAPE);
@@ -14,25 +41,145 @@ void handle_events(bool *exit) {
                 if (should_quit(&e)) {
                         *exit = true;
                 }
+                if (e.type == SDL_EVENT_KEY_DOWN && e.key.key == SDLK_RETURN && !e.key.repeat) {
+                        world_end_turn();
+                }
         }
 }
 
+static double now_ms() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+
+        return ts.tv_sec * 1e3 + ts.tv_nsec * 1e-6;
+}
+
+static void benchmark_write_stats(FILE *f, const char *name, stats_t *stats) {
+        fprintf(f,
+                "  \"%s\": {\"samples\": %u, \"mean\": %.4f, \"p50\": %.4f, \"p90\": %.4f, "
+                "\"p99\": %.4f, \"max\": %.4f}",
+                name, stats_count(stats), stats_mean(stats), stats_percentile(stats, 50.0),
+                stats_percentile(stats, 90.0), stats_percentile(stats, 99.0),
+                stats_percentile(stats, 100.0));
+}
+
+static void benchmark_report(benchmark_t *b, renderer_config_t *config) {
+        FILE *f = fopen(b->output, "w");
+        if (!f) {
+                ERROR("failed to open benchmark output %s", b->output);
+                return;
+        }
+
+        uint32_t frames = stats_count(&b->cpu);
+
+        // Throughput percentiles are derived from frame times, so p99 is the slowest 1% of frames
+        fprintf(f, "{\n");
+        fprintf(f, "  \"width\": %u, \"height\": %u, \"frames\": %u,\n", config->width,
+                config->height, frames);
+        benchmark_write_stats(f, "cpu_ms", &b->cpu);
+        fprintf(f, ",\n");
+        benchmark_write_stats(f, "gpu_ms", &b->gpu);
+        fprintf(f, ",\n");
+
+        render_pass_timing_t passes[MAX_PASSES];
+        uint32_t pass_count = renderer_pass_timings(passes);
+        fprintf(f, "  \"passes_ms\": {");
+        for (uint32_t p = 0; p < pass_count; p += 1) {
+                fprintf(f, "%s\"%s\": %.4f", p ? ", " : "", passes[p].name, passes[p].average_ms);
+        }
+        fprintf(f, "},\n");
+
+        frame_pacing_stats_t pacing = renderer_frame_pacing();
+        fprintf(f,
+                "  \"pacing_ms\": {\"interval\": %.4f, \"interval_max\": %.4f, \"wait\": %.4f, "
+                "\"sleep\": %.4f, \"cpu\": %.4f},\n",
+                pacing.interval_ms, pacing.interval_max_ms, pacing.wait_ms, pacing.sleep_ms,
+                pacing.cpu_ms);
+
+        id_allocator_stats_t textures = bindless_stats();
+        fprintf(f, "  \"texture_slots\": {\"used\": %u, \"peak\": %u, \"capacity\": %u},\n",
+                textures.used, textures.peak, textures.capacity);
+        id_allocator_stats_t materials = material_stats();
+        fprintf(f, "  \"materials\": {\"used\": %u, \"peak\": %u, \"capacity\": %u},\n",
+                materials.used, materials.peak, materials.capacity);
+        fprintf(f,
+                "  \"fps\": {\"mean\": %.2f, \"p50\": %.2f, \"p90\": %.2f, \"p99\": %.2f}\n",
+                frames / (b->elapsed * 1e-3), 1e3 / stats_percentile(&b->cpu, 50.0),
+                1e3 / stats_percentile(&b->cpu, 90.0), 1e3 / stats_percentile(&b->cpu, 99.0));
+        fprintf(f, "}\n");
+
+        fclose(f);
+        INFO("benchmark: %u frames, cpu p50 %.3f ms, gpu p50 %.3f ms, written to %s", frames,
+             stats_percentile(&b->cpu, 50.0), stats_percentile(&b->gpu, 50.0), b->output);
+}
+
+// Returns false unless `text` is a whole, positive frame count
+static bool parse_frame_count(const char *text, uint32_t *frames) {
+        char *end;
+        errno = 0;
+        unsigned long value = strtoul(text, &end, 10);
+        if (errno || end == text || *end || text[0] == '-' || value == 0 ||
+            value > UINT32_MAX - BENCHMARK_WARMUP_FRAMES) {
+                return false;
+        }
+
+        *frames = (uint32_t)value;
+        return true;
+}
+
 int main(int argc, char **argv) {
         renderer_config_t config = {
             .width = 1920,
             .height = 1080,
             .title = "Civ Game",
             .debug = true,
+            .low_latency = true,
+            .target_gpu_ms = 16.0f,
+            .min_render_scale = 0.5f,
         };
+
+        benchmark_t benchmark = {.output = "benchmark.json"};
+        if (argc > 1 && strcmp(argv[1], "--benchmark") == 0) {
+                uint32_t frames;
+                if (argc < 3 || argc > 4 || !parse_frame_count(argv[2], &frames)) {
+                        fprintf(stderr, "%s\n", USAGE);
+                        return 1;
+                }
+
+                config.headless = true;
+                config.debug = false;
+                config.low_latency = false;
+                // Measure at a fixed resolution
+                config.target_gpu_ms = 0.0f;
+                config.frame_count = BENCHMARK_WARMUP_FRAMES + frames;
+                benchmark.output = argc > 3 ? argv[3] : benchmark.output;
+                benchmark.cpu = stats_create();
+                benchmark.gpu = stats_create();
+        }
+
+        PROFILE_THREAD("main");
+        jobs_init(0);
+
         if (!renderer_init(&config)) {
                 return -1;
         }
 
         world_init();
+        world_set_camera_path(config.headless);
 
+        double start = 0.0;
         bool exit = false;
-        while (!exit) {
-                handle_events(&exit);
+        for (uint32_t frame = 0; !exit && (!config.frame_count || frame < config.frame_count);
+             frame += 1) {
+                if (frame == BENCHMARK_WARMUP_FRAMES) {
+                        start = now_ms();
+                }
+                double frame_start = now_ms();
+
+                renderer_wait_frame();
+                if (!config.headless) {
+                        handle_events(&exit);
+                }
 
                 renderer_begin_frame();
 
@@ -41,9 +188,30 @@ int main(int argc, char **argv) {
                 renderer_draw();
 
                 renderer_end_frame();
+
+                if (config.headless && frame >= BENCHMARK_WARMUP_FRAMES) {
+                        stats_add(&benchmark.cpu, now_ms() - frame_start);
+
+                        // Timestamps lag a few frames behind, the last ones are never read
+                        double gpu = renderer_gpu_frame_time();
+                        if (gpu >= 0.0) {
+                                stats_add(&benchmark.gpu, gpu);
+                        }
+                }
         }
 
+        if (config.headless) {
+                benchmark.elapsed = now_ms() - start;
+                benchmark_report(&benchmark, &config);
+                stats_destroy(&benchmark.cpu);
+                stats_destroy(&benchmark.gpu);
+        }
+
+        PROFILE_WRITE_TRACE(config.headless ? "benchmark_trace.json" : "trace.json");
+
         world_shutdown();
         renderer_shutdown();
+        jobs_shutdown();
+        PROFILE_SHUTDOWN();
         return 0;
 }
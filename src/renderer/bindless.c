@@ -0,0 +1,133 @@
+#include "renderer/bindless.h"
+
+#include "renderer/deletion_queue.h"
+#include "renderer/vk_context.h"
+
+#include "common/id_allocator.h"
+
+#include <pthread.h>
+
+typedef struct bindless {
+        VkDescriptorPool pool;
+        DescriptorLayout layout;
+        Descriptor descriptor;
+
+        pthread_mutex_t lock;
+        id_allocator_t slots;
+} bindless_t;
+
+static bindless_t g_bindless = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+static uint32_t bindless_capacity() {
+        VkPhysicalDeviceVulkan12Properties properties12 = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES,
+        };
+        VkPhysicalDeviceProperties2 properties = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+            .pNext = &properties12,
+        };
+        vkGetPhysicalDeviceProperties2(vk_context_physical_device(), &properties);
+
+        uint32_t limits[] = {
+            BINDLESS_MAX_TEXTURES,
+            properties12.maxDescriptorSetUpdateAfterBindSampledImages,
+            properties12.maxDescriptorSetUpdateAfterBindSamplers,
+            properties12.maxPerStageDescriptorUpdateAfterBindSampledImages,
+            properties12.maxPerStageDescriptorUpdateAfterBindSamplers,
+        };
+
+        uint32_t capacity = limits[0];
+        for (uint32_t i = 1; i < sizeof(limits) / sizeof(limits[0]); i += 1) {
+                capacity = limits[i] < capacity ? limits[i] : capacity;
+        }
+
+        return capacity;
+}
+
+void bindless_init() {
+        uint32_t capacity = bindless_capacity();
+        g_bindless.slots = id_allocator_create(capacity);
+
+        VkDescriptorPoolSize size = {
+            .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorCount = capacity,
+        };
+        VkDescriptorPoolCreateInfo pool_info = {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+            .flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT,
+            .maxSets = 1,
+            .poolSizeCount = 1,
+            .pPoolSizes = &size,
+        };
+        VK_EXPECT(vkCreateDescriptorPool(vk_context_device(), &pool_info, NULL, &g_bindless.pool));
+
+        DescriptorBinding binding = {
+            .type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .count = capacity,
+            .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+            .variable = true,
+        };
+        g_bindless.layout = descriptor_layout_create(vk_context_device(), &binding, 1);
+
+        VkDescriptorSetVariableDescriptorCountAllocateInfo variable_info = {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO,
+            .descriptorSetCount = 1,
+            .pDescriptorCounts = &capacity,
+        };
+        VkDescriptorSetAllocateInfo alloc_info = {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+            .pNext = &variable_info,
+            .descriptorPool = g_bindless.pool,
+            .descriptorSetCount = 1,
+            .pSetLayouts = &g_bindless.layout.layout,
+        };
+        g_bindless.descriptor.layout = &g_bindless.layout;
+        VK_EXPECT(vkAllocateDescriptorSets(vk_context_device(), &alloc_info,
+                                           &g_bindless.descriptor.descriptor));
+
+        INFO("bindless: %u texture slots", capacity);
+}
+
+void bindless_shutdown() {
+        vkDestroyDescriptorPool(vk_context_device(), g_bindless.pool, NULL);
+        descriptor_layout_destroy(&g_bindless.layout);
+        id_allocator_destroy(&g_bindless.slots);
+
+        g_bindless = (bindless_t){.lock = PTHREAD_MUTEX_INITIALIZER};
+}
+
+DescriptorLayout *bindless_layout() { return &g_bindless.layout; }
+Descriptor *bindless_descriptor() { return &g_bindless.descriptor; }
+
+uint32_t bindless_texture_add(Image *image, VkSampler sampler) {
+        pthread_mutex_lock(&g_bindless.lock);
+        uint32_t slot = id_allocator_acquire(&g_bindless.slots);
+        pthread_mutex_unlock(&g_bindless.lock);
+
+        // The binding is update after bind, other slots can be written while frames use the set
+        descriptor_write_texture(g_bindless.descriptor, image, 0, slot, sampler);
+
+        return slot;
+}
+
+static void bindless_slot_release(uint64_t slot) {
+        pthread_mutex_lock(&g_bindless.lock);
+        id_allocator_release(&g_bindless.slots, (uint32_t)slot);
+        pthread_mutex_unlock(&g_bindless.lock);
+}
+
+void bindless_texture_remove(uint32_t slot) {
+        pthread_mutex_lock(&g_bindless.lock);
+        ASSERT(id_allocator_issued(&g_bindless.slots, slot));
+        pthread_mutex_unlock(&g_bindless.lock);
+
+        deletion_queue_retire(bindless_slot_release, slot);
+}
+
+id_allocator_stats_t bindless_stats() {
+        pthread_mutex_lock(&g_bindless.lock);
+        id_allocator_stats_t stats = id_allocator_stats(&g_bindless.slots);
+        pthread_mutex_unlock(&g_bindless.lock);
+
+        return stats;
+}
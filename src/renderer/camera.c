@@ -3,7 +3,17 @@
 #include "renderer/platform.h"
 #include "renderer/swapchain.h"
 
+static mat4 g_viewproj = GLM_MAT4_IDENTITY_INIT;
+
 void renderer_set_camera(camera_t camera) {
+        uint32_t w, h;
+        platform_get_size(&w, &h);
+        // Frames aren't rendered while the window has no area, and the current frame's buffer
+        // may still be in use by the GPU
+        if (!w || !h) {
+                return;
+        }
+
         SceneData *scene = swapchain_current_frame_get_buffer(FRAME_BUFFER_CAMERA);
 
         // Vulkan internally uses an inverted Y-axis compared to cglm. That is, y=0 is the top of
@@ -17,12 +27,11 @@ void renderer_set_camera(camera_t camera) {
         glm_look(eye, camera.target, camera.up, scene->view);
         glm_scale(scene->view, flip);
 
-        uint32_t w, h;
-        platform_get_size(&w, &h);
-
-        glm_perspective(glm_rad(camera.fov), (float)w / h, 0.1f, 100.0f, scene->proj);
+        glm_perspective(glm_rad(camera.fov), (float)w / h, CAMERA_NEAR, CAMERA_FAR, scene->proj);
+        glm_vec4_copy((vec4){CAMERA_NEAR, CAMERA_FAR, 0.0f, 0.0f}, scene->clip);
 
         glm_mat4_mul(scene->proj, scene->view, scene->viewproj);
+        glm_mat4_copy(scene->viewproj, g_viewproj);
 
         scene->ambientColor[0] = 1.0f;
         scene->ambientColor[1] = 1.0f;
@@ -36,3 +45,5 @@ void renderer_set_camera(camera_t camera) {
 
         swapchain_current_frame_unmap_buffer(FRAME_BUFFER_CAMERA);
 }
+
+void renderer_camera_viewproj(mat4 dest) { glm_mat4_copy(g_viewproj, dest); }
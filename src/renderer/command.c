@@ -1,27 +1,39 @@
 #include "renderer/command.h"
 
+#include "renderer/timeline.h"
 #include "renderer/vk_context.h"
 
+#include "common/array.h"
+#include "common/job.h"
+
+#include "husky.h"
+
+#include <stdlib.h>
+
 typedef struct immediate_command {
         VkCommandPool pool;
         VkCommandBuffer command;
-        VkFence fence;
 
         VkDevice device;
-        VkQueue queue;
 } immediate_command_t;
 
 static immediate_command_t g_immediate_command;
 
+typedef struct secondary_pool {
+        VkCommandPool pool;        // created by the worker the first time it records
+        VkCommandBuffer *commands; // array, reused every time the frame slot comes around
+        uint32_t used;
+} secondary_pool_t;
+
+typedef struct secondary_commands {
+        secondary_pool_t *pools; // SECONDARY_COMMAND_MAX_FRAMES * worker_count
+        uint32_t worker_count;
+} secondary_commands_t;
+
+static secondary_commands_t g_secondary_commands;
+
 void immediate_command_init() {
-        g_immediate_command.queue = vk_context_graphics_queue();
         g_immediate_command.device = vk_context_device();
-        VkFenceCreateInfo fence_info = {
-            .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-            .flags = 0,
-        };
-        VK_EXPECT(
-            vkCreateFence(vk_context_device(), &fence_info, NULL, &g_immediate_command.fence));
 
         VkCommandPoolCreateInfo command_pool_info = {
             .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
@@ -43,7 +55,6 @@ void immediate_command_init() {
 
 void immediate_command_shutdown() {
         vkDestroyCommandPool(g_immediate_command.device, g_immediate_command.pool, NULL);
-        vkDestroyFence(g_immediate_command.device, g_immediate_command.fence, NULL);
 }
 
 VkCommandBuffer immediate_command_begin() {
@@ -69,10 +80,88 @@ void immediate_command_end() {
             .pCommandBufferInfos = &cmd_info,
             .commandBufferInfoCount = 1,
         };
-        vkQueueSubmit2(g_immediate_command.queue, 1, &submit_info, g_immediate_command.fence);
-        vkWaitForFences(g_immediate_command.device, 1, &g_immediate_command.fence, VK_TRUE,
-                        1000000000);
+        timeline_wait(timeline_submit(&submit_info));
 
-        vkResetFences(g_immediate_command.device, 1, &g_immediate_command.fence);
         vkResetCommandPool(g_immediate_command.device, g_immediate_command.pool, 0);
 }
+
+void secondary_commands_init() {
+        g_secondary_commands.worker_count = jobs_worker_count();
+        g_secondary_commands.pools =
+            calloc(SECONDARY_COMMAND_MAX_FRAMES * g_secondary_commands.worker_count,
+                   sizeof(secondary_pool_t));
+}
+
+void secondary_commands_shutdown() {
+        uint32_t count = SECONDARY_COMMAND_MAX_FRAMES * g_secondary_commands.worker_count;
+        for (uint32_t i = 0; i < count; i += 1) {
+                secondary_pool_t *pool = &g_secondary_commands.pools[i];
+                if (pool->pool) {
+                        vkDestroyCommandPool(vk_context_device(), pool->pool, NULL);
+                        array_free(pool->commands);
+                }
+        }
+
+        free(g_secondary_commands.pools);
+        g_secondary_commands = (secondary_commands_t){0};
+}
+
+static secondary_pool_t *secondary_pool(uint32_t frame, uint32_t worker) {
+        ASSERT(frame < SECONDARY_COMMAND_MAX_FRAMES);
+        ASSERT(worker < g_secondary_commands.worker_count);
+
+        return &g_secondary_commands.pools[frame * g_secondary_commands.worker_count + worker];
+}
+
+void secondary_commands_reset(uint32_t frame) {
+        for (uint32_t w = 0; w < g_secondary_commands.worker_count; w += 1) {
+                secondary_pool_t *pool = secondary_pool(frame, w);
+                if (pool->pool) {
+                        VK_EXPECT(vkResetCommandPool(vk_context_device(), pool->pool, 0));
+                        pool->used = 0;
+                }
+        }
+}
+
+VkCommandBuffer secondary_command_begin(uint32_t frame, uint32_t worker,
+                                        const VkCommandBufferInheritanceRenderingInfo *rendering) {
+        secondary_pool_t *pool = secondary_pool(frame, worker);
+
+        if (!pool->pool) {
+                VkCommandPoolCreateInfo pool_info = {
+                    .sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+                    .flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
+                    .queueFamilyIndex = vk_context_queue_family_index(),
+                };
+                VK_EXPECT(vkCreateCommandPool(vk_context_device(), &pool_info, NULL, &pool->pool));
+                pool->commands = array(VkCommandBuffer);
+        }
+
+        if (pool->used == array_length(pool->commands)) {
+                VkCommandBufferAllocateInfo alloc_info = {
+                    .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+                    .commandPool = pool->pool,
+                    .level = VK_COMMAND_BUFFER_LEVEL_SECONDARY,
+                    .commandBufferCount = 1,
+                };
+                VkCommandBuffer command;
+                VK_EXPECT(vkAllocateCommandBuffers(vk_context_device(), &alloc_info, &command));
+                array_append(pool->commands, command);
+        }
+
+        VkCommandBuffer command = pool->commands[pool->used++];
+
+        VkCommandBufferInheritanceInfo inheritance = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO,
+            .pNext = rendering,
+        };
+        VkCommandBufferBeginInfo begin = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+            .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+                     (rendering ? VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT : 0),
+            .pInheritanceInfo = &inheritance,
+        };
+        VK_EXPECT(vkBeginCommandBuffer(command, &begin));
+
+        return command;
+}
@@ -0,0 +1,138 @@
+#include "renderer/deletion_queue.h"
+
+#include "renderer/timeline.h"
+#include "renderer/vk_context.h"
+
+#include "common/array.h"
+
+#include <pthread.h>
+#include <string.h>
+
+typedef enum retired_type {
+        RETIRED_BUFFER,
+        RETIRED_IMAGE,
+        RETIRED_PIPELINE,
+        RETIRED_CALLBACK,
+} retired_type_t;
+
+typedef struct retired {
+        retired_type_t type;
+        uint64_t value; // zero until sealed
+
+        union {
+                buffer_t buffer;
+                AllocatedImage image;
+                struct {
+                        VkPipeline pipeline;
+                        VkPipelineLayout layout;
+                } pipeline;
+                struct {
+                        void (*fn)(uint64_t handle);
+                        uint64_t handle;
+                } callback;
+        };
+} retired_t;
+
+typedef struct deletion_queue {
+        pthread_mutex_t lock;
+
+        // Sealed entries come first, in submission order, followed by the unsealed ones
+        retired_t *entries; // array
+        uint32_t sealed;
+} deletion_queue_t;
+
+static deletion_queue_t g_deletion_queue = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+void deletion_queue_init() { g_deletion_queue.entries = array(retired_t); }
+
+static void retired_destroy(retired_t *retired) {
+        switch (retired->type) {
+        case RETIRED_BUFFER:
+                buffer_destroy(&retired->buffer);
+                break;
+        case RETIRED_IMAGE:
+                allocated_image_destroy(&retired->image, vk_context_device());
+                break;
+        case RETIRED_PIPELINE:
+                vkDestroyPipeline(vk_context_device(), retired->pipeline.pipeline, NULL);
+                vkDestroyPipelineLayout(vk_context_device(), retired->pipeline.layout, NULL);
+                break;
+        case RETIRED_CALLBACK:
+                retired->callback.fn(retired->callback.handle);
+                break;
+        }
+}
+
+void deletion_queue_shutdown() {
+        for (uint32_t i = 0; i < array_length(g_deletion_queue.entries); i += 1) {
+                retired_destroy(&g_deletion_queue.entries[i]);
+        }
+
+        array_free(g_deletion_queue.entries);
+        g_deletion_queue.entries = NULL;
+        g_deletion_queue.sealed = 0;
+}
+
+static void deletion_queue_push(retired_t retired) {
+        pthread_mutex_lock(&g_deletion_queue.lock);
+        array_append(g_deletion_queue.entries, retired);
+        pthread_mutex_unlock(&g_deletion_queue.lock);
+}
+
+void deletion_queue_retire_buffer(buffer_t *buffer) {
+        deletion_queue_push((retired_t){.type = RETIRED_BUFFER, .buffer = *buffer});
+        *buffer = (buffer_t){0};
+}
+
+void deletion_queue_retire_image(AllocatedImage *image) {
+        deletion_queue_push((retired_t){.type = RETIRED_IMAGE, .image = *image});
+        *image = (AllocatedImage){0};
+}
+
+void deletion_queue_retire_pipeline(VkPipeline pipeline, VkPipelineLayout layout) {
+        deletion_queue_push((retired_t){
+            .type = RETIRED_PIPELINE,
+            .pipeline = {pipeline, layout},
+        });
+}
+
+void deletion_queue_retire(void (*fn)(uint64_t handle), uint64_t handle) {
+        deletion_queue_push((retired_t){
+            .type = RETIRED_CALLBACK,
+            .callback = {fn, handle},
+        });
+}
+
+void deletion_queue_seal(uint64_t value) {
+        pthread_mutex_lock(&g_deletion_queue.lock);
+
+        uint32_t count = array_length(g_deletion_queue.entries);
+        for (uint32_t i = g_deletion_queue.sealed; i < count; i += 1) {
+                g_deletion_queue.entries[i].value = value;
+        }
+        g_deletion_queue.sealed = count;
+
+        pthread_mutex_unlock(&g_deletion_queue.lock);
+}
+
+void deletion_queue_collect() {
+        pthread_mutex_lock(&g_deletion_queue.lock);
+
+        retired_t *entries = g_deletion_queue.entries;
+        uint32_t count = array_length(entries);
+
+        // Values only grow, so stop at the first one the GPU hasn't reached
+        uint32_t done = 0;
+        while (done < g_deletion_queue.sealed && timeline_reached(entries[done].value)) {
+                retired_destroy(&entries[done]);
+                done += 1;
+        }
+
+        if (done) {
+                memmove(entries, entries + done, sizeof(retired_t) * (count - done));
+                array_header(entries)->length = count - done;
+                g_deletion_queue.sealed -= done;
+        }
+
+        pthread_mutex_unlock(&g_deletion_queue.lock);
+}
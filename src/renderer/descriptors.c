@@ -1,5 +1,6 @@
 #include "renderer/descriptors.h"
 
+#include "renderer/deletion_queue.h"
 #include "renderer/vk_context.h"
 #include "renderer/vkb.h"
 
@@ -85,8 +86,8 @@ void descriptor_layout_destroy(DescriptorLayout *layout) {
         array_free(layout->variable);
 }
 
-void descriptors_init() {
-        descriptor_allocator_init(NUM_FRAMES);
+void descriptors_init(uint32_t frames_in_flight) {
+        descriptor_allocator_init(frames_in_flight);
 
         global_descriptor_layout_init();
 
@@ -98,27 +99,48 @@ void descriptors_shutdown() {
         vkDestroyDescriptorSetLayout(vk_context_device(), g_global_descriptor_layout.layout, NULL);
 }
 
+// The pool is created before any pass registers, so the sets passes allocate for themselves are
+// budgeted here: the visibility map and the gradient pass's draw image, one storage image each.
+// The gradient pass replaces its set on every resize, and up to one old set per frame in flight
+// waits in the deletion queue to be freed. Add to this when a pass allocates a new set.
+static void pass_descriptors_reserve() {
+        DescriptorBinding storage_images[2] = {
+            {.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .count = 2},
+            {.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, .count = 1},
+        };
+        descriptor_allocator_reserve(&storage_images[0], 1, false);
+        descriptor_allocator_reserve(&storage_images[1], 1, true);
+}
+
 void global_descriptor_layout_init() {
-        DescriptorBinding global_bindings[4] = {
-            {.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+        // Textures live in their own set, see bindless.h
+        DescriptorBinding global_bindings[5] = {
+            {.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
              .count = 1,
-             .stage = VK_SHADER_STAGE_ALL_GRAPHICS},
-            {.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+             .stage = VK_SHADER_STAGE_ALL_GRAPHICS | VK_SHADER_STAGE_COMPUTE_BIT},
+            {.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
              .count = 1,
              .stage = VK_SHADER_STAGE_VERTEX_BIT},
-            {.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-             .count = MAX_TEXTURES,
-             .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
-             .variable = true},
-            {.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+            // Material table, see material.h
+            {.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+             .count = 1,
+             .stage = VK_SHADER_STAGE_ALL_GRAPHICS | VK_SHADER_STAGE_COMPUTE_BIT},
+            // Point lights and the clusters they are binned into, see lights.h
+            {.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC,
+             .count = 1,
+             .stage = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT},
+            {.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
              .count = 1,
-             .stage = VK_SHADER_STAGE_COMPUTE_BIT},
+             .stage = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT},
         };
         uint32_t count = sizeof(global_bindings) / sizeof(DescriptorBinding);
 
-        descriptor_allocator_reserve(global_bindings, count, true);
+        // A single set serves every frame in flight, see swapchain_current_frame_global_offsets()
+        descriptor_allocator_reserve(global_bindings, count, false);
         g_global_descriptor_layout =
-            descriptor_layout_create(vk_context_device(), global_bindings, 3);
+            descriptor_layout_create(vk_context_device(), global_bindings, count);
+
+        pass_descriptors_reserve();
 }
 DescriptorLayout *global_descriptor_layout() { return &g_global_descriptor_layout; }
 
@@ -207,7 +229,8 @@ Descriptor descriptor_allocate(DescriptorLayout *layout) {
             .pNext = var_count ? &var_bindings : VK_NULL_HANDLE,
         };
 
-        vkAllocateDescriptorSets(g_descriptor_allocator.device, &alloc_info, &r.descriptor);
+        VK_EXPECT(
+            vkAllocateDescriptorSets(g_descriptor_allocator.device, &alloc_info, &r.descriptor));
 
         return r;
 }
@@ -217,6 +240,16 @@ void descriptor_free(Descriptor *descriptor) {
                              &descriptor->descriptor);
 }
 
+static void descriptor_retired_free(uint64_t handle) {
+        VkDescriptorSet set = (VkDescriptorSet)(uintptr_t)handle;
+        vkFreeDescriptorSets(vk_context_device(), g_descriptor_allocator.pool, 1, &set);
+}
+
+void descriptor_retire(Descriptor *descriptor) {
+        deletion_queue_retire(descriptor_retired_free, (uintptr_t)descriptor->descriptor);
+        descriptor->descriptor = VK_NULL_HANDLE;
+}
+
 void descriptor_write_image(Descriptor descriptor, Image *image, uint32_t binding,
                             uint32_t arr_index) {
         VkDescriptorImageInfo image_info = {
@@ -262,10 +295,15 @@ void descriptor_write_texture(Descriptor descriptor, Image *image, uint32_t bind
 
 void descriptor_write_buffer(Descriptor descriptor, buffer_t *buffer, uint32_t binding,
                              uint32_t arr_index) {
+        descriptor_write_buffer_range(descriptor, buffer, binding, arr_index, buffer->info.size);
+}
+
+void descriptor_write_buffer_range(Descriptor descriptor, buffer_t *buffer, uint32_t binding,
+                                   uint32_t arr_index, VkDeviceSize range) {
         VkDescriptorBufferInfo buffer_info = {
             .buffer = buffer->buffer,
             .offset = 0,
-            .range = buffer->info.size,
+            .range = range,
         };
 
         VkWriteDescriptorSet write_set = {
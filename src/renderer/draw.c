@@ -5,6 +5,7 @@
 #include "renderer/swapchain.h"
 
 #include "common/array.h"
+#include "common/profiler.h"
 
 typedef struct render_object {
         uint32_t mesh;
@@ -58,12 +59,13 @@ static void render_object_compact(render_object_t obj, Instance *ssbo, uint32_t
         draw_batch_t draw_batch = {.mesh = obj.mesh, .first_instance = *instance_count};
 
         for (int i = 0; i < array_length(g_render_objects); i++) {
-                if (g_render_objects[i].mesh == obj.mesh) {
+                if (render_object_compatible(g_render_objects[i], obj)) {
+                        // The material is looked up per instance, it doesn't split batches
                         ssbo[*instance_count] = (Instance){
                             .vertex_address = gpu_mesh_vertex_address(obj.mesh),
-                            .tex_index = obj.material.diffuse_tex,
+                            .material = g_render_objects[i].material.id,
                         };
-                        glm_mat4_dup(obj.transform, ssbo[*instance_count].model);
+                        glm_mat4_dup(g_render_objects[i].transform, ssbo[*instance_count].model);
 
                         draw_batch.count++;
                         (*instance_count)++;
@@ -74,6 +76,8 @@ static void render_object_compact(render_object_t obj, Instance *ssbo, uint32_t
 }
 
 void draw_batches_upload() {
+        PROFILE_ZONE("draw_batches_upload");
+
         Instance *ssbo = (Instance *)swapchain_current_frame_get_buffer(FRAME_BUFFER_INSTANCES);
 
         uint32_t instance_count = 0;
@@ -85,14 +89,22 @@ void draw_batches_upload() {
         swapchain_current_frame_unmap_buffer(FRAME_BUFFER_INSTANCES);
 }
 
-void draw_batches_record() {
-        for (int i = 0; i < array_length(g_draw_batches); i++) {
+uint32_t draw_batches_chunk_count() {
+        uint32_t count = array_length(g_draw_batches);
+
+        return count ? (count + DRAW_BATCHES_PER_CHUNK - 1) / DRAW_BATCHES_PER_CHUNK : 1;
+}
+
+void draw_batches_record(VkCommandBuffer cmd, uint32_t chunk, uint32_t chunk_count) {
+        uint32_t count = array_length(g_draw_batches);
+        uint32_t first = (uint64_t)count * chunk / chunk_count;
+        uint32_t last = (uint64_t)count * (chunk + 1) / chunk_count;
+
+        for (uint32_t i = first; i < last; i++) {
                 uint32_t mesh = g_draw_batches[i].mesh;
-                vkCmdBindIndexBuffer(swapchain_current_frame_command_buffer(),
-                                     gpu_mesh_index_buffer(mesh), 0, VK_INDEX_TYPE_UINT32);
+                vkCmdBindIndexBuffer(cmd, gpu_mesh_index_buffer(mesh), 0, VK_INDEX_TYPE_UINT32);
 
-                vkCmdDrawIndexed(swapchain_current_frame_command_buffer(),
-                                 gpu_mesh_index_count(mesh), g_draw_batches[i].count, 0, 0,
+                vkCmdDrawIndexed(cmd, gpu_mesh_index_count(mesh), g_draw_batches[i].count, 0, 0,
                                  g_draw_batches[i].first_instance);
         }
 }
@@ -0,0 +1,145 @@
+#include "renderer/frame_pacing.h"
+
+#include "renderer/swapchain.h"
+
+#include "common/profiler.h"
+
+#include <time.h>
+
+#define FRAME_PACING_SMOOTHING 0.1
+// Sleeps overshoot and frame times vary, so aim to submit a little before the GPU runs dry
+#define FRAME_PACING_SLACK_MS 1.0
+
+typedef struct frame_sample {
+        double interval;
+        double wait;
+        double sleep;
+        double cpu;
+} frame_sample_t;
+
+typedef struct frame_pacing {
+        bool low_latency;
+
+        // Milliseconds on the monotonic clock, zero until the first frame
+        double frame_start;
+        double last_submit;
+
+        // Moving averages
+        double cpu_ms;
+        double gpu_ms;
+
+        double wait;
+        double sleep;
+        double cpu;
+
+        frame_sample_t samples[FRAME_PACING_WINDOW];
+        uint32_t sample_count;
+        uint32_t next_sample;
+} frame_pacing_t;
+
+static frame_pacing_t g_frame_pacing;
+
+static double frame_pacing_now() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+
+        return ts.tv_sec * 1e3 + ts.tv_nsec * 1e-6;
+}
+
+static void frame_pacing_sleep_until(double target) {
+        double remaining = target - frame_pacing_now();
+        if (remaining <= 0.0) {
+                return;
+        }
+
+        uint64_t ns = remaining * 1e6;
+        nanosleep(&(struct timespec){.tv_sec = ns / 1000000000, .tv_nsec = ns % 1000000000}, NULL);
+}
+
+static double frame_pacing_average(double average, double sample) {
+        return average ? average + (sample - average) * FRAME_PACING_SMOOTHING : sample;
+}
+
+void frame_pacing_init(bool low_latency) {
+        g_frame_pacing = (frame_pacing_t){.low_latency = low_latency};
+}
+
+void frame_pacing_wait() {
+        PROFILE_ZONE("frame_wait");
+
+        frame_pacing_t *p = &g_frame_pacing;
+        double begin = frame_pacing_now();
+
+        // Waiting on the oldest frame in flight is the usual limit, low latency keeps the GPU at
+        // most one frame behind
+        uint32_t frames = swapchain_frame_count();
+        uint32_t age = p->low_latency && frames > 1 ? 1 : frames - 1;
+        bool waited = swapchain_wait_submitted(age);
+
+        double waited_until = frame_pacing_now();
+        if (p->low_latency && p->gpu_ms > 0.0) {
+                // The GPU is now busy with the last frame at most, which started when it was
+                // submitted or, if we had to wait, just now
+                double gpu_start = waited ? waited_until : p->last_submit;
+                frame_pacing_sleep_until(gpu_start + p->gpu_ms - p->cpu_ms -
+                                         FRAME_PACING_SLACK_MS);
+        }
+
+        double start = frame_pacing_now();
+        if (p->frame_start) {
+                p->samples[p->next_sample] = (frame_sample_t){
+                    .interval = start - p->frame_start,
+                    .wait = p->wait,
+                    .sleep = p->sleep,
+                    .cpu = p->cpu,
+                };
+                p->next_sample = (p->next_sample + 1) % FRAME_PACING_WINDOW;
+                p->sample_count += p->sample_count < FRAME_PACING_WINDOW;
+        }
+
+        p->frame_start = start;
+        p->wait = waited_until - begin;
+        p->sleep = start - waited_until;
+}
+
+void frame_pacing_submit(double gpu_ms) {
+        frame_pacing_t *p = &g_frame_pacing;
+        if (!p->frame_start) {
+                return;
+        }
+
+        double now = frame_pacing_now();
+        p->cpu = now - p->frame_start;
+        p->cpu_ms = frame_pacing_average(p->cpu_ms, p->cpu);
+        if (gpu_ms >= 0.0) {
+                p->gpu_ms = frame_pacing_average(p->gpu_ms, gpu_ms);
+        }
+        p->last_submit = now;
+}
+
+frame_pacing_stats_t frame_pacing_stats() {
+        frame_pacing_t *p = &g_frame_pacing;
+        frame_pacing_stats_t stats = {0};
+        if (!p->sample_count) {
+                return stats;
+        }
+
+        for (uint32_t i = 0; i < p->sample_count; i += 1) {
+                frame_sample_t *sample = &p->samples[i];
+
+                stats.interval_ms += sample->interval;
+                stats.wait_ms += sample->wait;
+                stats.sleep_ms += sample->sleep;
+                stats.cpu_ms += sample->cpu;
+                if (sample->interval > stats.interval_max_ms) {
+                        stats.interval_max_ms = sample->interval;
+                }
+        }
+
+        stats.interval_ms /= p->sample_count;
+        stats.wait_ms /= p->sample_count;
+        stats.sleep_ms /= p->sample_count;
+        stats.cpu_ms /= p->sample_count;
+
+        return stats;
+}
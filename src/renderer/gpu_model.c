@@ -1,13 +1,18 @@
 #include "renderer/gpu_model.h"
 
+#include "renderer/bindless.h"
 #include "renderer/command.h"
+#include "renderer/deletion_queue.h"
 #include "renderer/image.h"
+#include "renderer/material.h"
 #include "renderer/renderer.h"
 #include "renderer/sampler.h"
 #include "renderer/swapchain.h"
 #include "renderer/vk_context.h"
 
 #include "common/array.h"
+#include "common/profiler.h"
+#include "common/util.h"
 
 typedef struct mesh_buffer {
         buffer_t vertex;
@@ -17,16 +22,34 @@ typedef struct mesh_buffer {
         uint32_t num_indices;
 } mesh_buffer_t;
 
+// Identical textures are uploaded once and shared, `refs` counts the users. Textures match on the
+// 64-bit content hash together with their size and format, which makes a collision negligible.
+typedef struct texture {
+        AllocatedImage image;
+        uint64_t hash;
+        uint32_t refs;
+
+        size_t width;
+        size_t height;
+        VkFormat format;
+} texture_t;
+
 static mesh_buffer_t *g_mesh_buffers;
-static AllocatedImage *g_textures;
+static texture_t *g_textures; // indexed by bindless slot
 
-static uint32_t mesh_buffer_create(mesh_t *mesh) {
+static void gpu_storage_init() {
         static int init = 0;
         if (!init) {
                 g_mesh_buffers = array(mesh_buffer_t);
-                g_textures = array(AllocatedImage);
+                g_textures = array(texture_t);
                 init = 1;
         }
+}
+
+static uint32_t mesh_buffer_create(mesh_t *mesh) {
+        PROFILE_ZONE("gpu_upload_mesh");
+
+        gpu_storage_init();
 
         const size_t vertex_buffer_size = sizeof(vertex_t) * array_length(mesh->vertices);
         const size_t index_buffer_size = sizeof(uint32_t) * array_length(mesh->indices);
@@ -72,31 +95,79 @@ static uint32_t mesh_buffer_create(mesh_t *mesh) {
         return index;
 }
 
+uint32_t gpu_upload_mesh(mesh_t *mesh) { return mesh_buffer_create(mesh); }
+
 static void mesh_buffer_destroy(mesh_buffer_t *buffer) {
         buffer_destroy(&buffer->vertex);
         buffer_destroy(&buffer->index);
 }
 
-uint32_t gpu_upload_texture(material_info_t *mats) {
+uint32_t gpu_upload_texture(texture_data_t *texture) {
+        PROFILE_ZONE("gpu_upload_texture");
+
+        gpu_storage_init();
+
+        size_t size = texture->width * texture->height * 4;
+        uint64_t hash = hash_bytes(&texture->width, sizeof(size_t), HASH_SEED);
+        hash = hash_bytes(&texture->height, sizeof(size_t), hash);
+        hash = hash_bytes(texture->pixels, size, hash);
+
+        VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+
+        for (uint32_t i = 0; i < array_length(g_textures); i += 1) {
+                texture_t *t = &g_textures[i];
+                if (t->refs && t->hash == hash && t->width == texture->width &&
+                    t->height == texture->height && t->format == format) {
+                        t->refs += 1;
+                        return i;
+                }
+        }
+
         AllocatedImageCreateInfo create_info = {
-            .extent = (VkExtent3D){mats->diffuse_width, mats->diffuse_height, 1},
+            .extent = (VkExtent3D){texture->width, texture->height, 1},
             .aspect_flags = VK_IMAGE_ASPECT_COLOR_BIT,
-            .format = VK_FORMAT_R8G8B8A8_UNORM,
+            .format = format,
             .usage_flags = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
             .memory_props = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
             .memory_usage = VMA_MEMORY_USAGE_GPU_ONLY,
 
-            .data = (uint32_t *)mats->diffuse_tex,
+            .data = (uint32_t *)texture->pixels,
         };
 
-        uint32_t index = array_length(g_textures);
-        array_append(g_textures, (AllocatedImage){0});
-        AllocatedImage *image = &g_textures[index];
-        allocated_image_create(&create_info, image);
+        AllocatedImage image = {0};
+        allocated_image_create(&create_info, &image);
 
-        swapchain_descriptors_write_texture(&g_textures[index].image, index, linear_sampler());
+        // Textures are indexed by their bindless slot, which may be one freed earlier
+        uint32_t slot = bindless_texture_add(&image.image, linear_sampler());
+        while (array_length(g_textures) <= slot) {
+                array_append(g_textures, (texture_t){0});
+        }
+        g_textures[slot] = (texture_t){
+            .image = image,
+            .hash = hash,
+            .refs = 1,
+            .width = texture->width,
+            .height = texture->height,
+            .format = format,
+        };
 
-        return index;
+        return slot;
+}
+
+static uint32_t gpu_upload_material(material_info_t *info) {
+        gpu_material_t material = {
+            .metallic = info->metallic,
+            .roughness = info->roughness,
+        };
+        glm_vec4_copy(info->base_color, material.base_color);
+
+        for (int t = 0; t < MATERIAL_TEXTURE_COUNT; t += 1) {
+                material.textures[t] = info->textures[t].pixels
+                                           ? gpu_upload_texture(&info->textures[t])
+                                           : MATERIAL_NO_TEXTURE;
+        }
+
+        return material_create(&material);
 }
 
 GpuModel renderer_load_model(char *filename) {
@@ -106,30 +177,79 @@ GpuModel renderer_load_model(char *filename) {
 
         DEBUG("#meshes = %zu, #materials = %zu", array_length(m.meshes), array_length(m.materials));
 
+        // Each material is uploaded by the first mesh using it, every mesh holds a reference
+        uint32_t *materials = malloc(sizeof(uint32_t) * array_length(m.materials));
+        for (int i = 0; i < array_length(m.materials); i++) {
+                materials[i] = MATERIAL_MAX;
+        }
+
         for (int i = 0; i < array_length(m.meshes); i++) {
                 mesh_t *cpu_mesh = &m.meshes[i];
-                material_info_t *material = &m.materials[cpu_mesh->material_index];
+                uint32_t *material = &materials[cpu_mesh->material_index];
+                if (*material == MATERIAL_MAX) {
+                        *material = gpu_upload_material(&m.materials[cpu_mesh->material_index]);
+                } else {
+                        material_retain(*material);
+                }
+
                 GpuMesh mesh = {
                     .mesh = mesh_buffer_create(cpu_mesh),
-                    .material.diffuse_tex = gpu_upload_texture(material),
+                    .material.id = *material,
                 };
 
                 array_append(r.meshes, mesh);
         }
 
+        free(materials);
         model_destroy(m);
 
         return r;
 }
 
+void renderer_unload_model(GpuModel model) {
+        for (int i = 0; i < array_length(model.meshes); i++) {
+                gpu_unload_mesh(model.meshes[i].mesh);
+                material_release(model.meshes[i].material.id);
+        }
+
+        array_free(model.meshes);
+}
+
+void gpu_unload_mesh(uint32_t mesh) {
+        mesh_buffer_t *buffer = &g_mesh_buffers[mesh];
+        if (!buffer->vertex.buffer) {
+                return;
+        }
+
+        deletion_queue_retire_buffer(&buffer->vertex);
+        deletion_queue_retire_buffer(&buffer->index);
+        *buffer = (mesh_buffer_t){0};
+}
+
+void gpu_unload_texture(uint32_t texture) {
+        texture_t *t = &g_textures[texture];
+        if (!t->refs || --t->refs) {
+                return;
+        }
+
+        deletion_queue_retire_image(&t->image);
+        bindless_texture_remove(texture);
+}
+
 void gpu_unload_models() {
+        gpu_storage_init();
+
         for (int i = 0; i < array_length(g_mesh_buffers); i += 1) {
-                mesh_buffer_destroy(&g_mesh_buffers[i]);
+                if (g_mesh_buffers[i].vertex.buffer) {
+                        mesh_buffer_destroy(&g_mesh_buffers[i]);
+                }
         }
         array_free(g_mesh_buffers);
 
         for (int i = 0; i < array_length(g_textures); i += 1) {
-                allocated_image_destroy(&g_textures[i], vk_context_device());
+                if (g_textures[i].image.image.image) {
+                        allocated_image_destroy(&g_textures[i].image, vk_context_device());
+                }
         }
         array_free(g_textures);
 }
@@ -0,0 +1,108 @@
+#include "renderer/gpu_timer.h"
+
+#include "renderer/vk_context.h"
+
+#include <stdbool.h>
+
+// Every frame owns a range of the pool: its own begin and end, followed by a pair per scope
+#define FRAME_QUERIES (2 + GPU_TIMER_MAX_SCOPES * 2)
+
+typedef struct gpu_timer {
+        VkQueryPool pool;
+        bool recorded[GPU_TIMER_MAX_FRAMES];
+
+        uint32_t scope_count[GPU_TIMER_MAX_FRAMES];     // last finished recording of the frame
+        uint32_t recording_scopes[GPU_TIMER_MAX_FRAMES]; // the one in progress
+} gpu_timer_t;
+
+static gpu_timer_t g_gpu_timer;
+
+static uint32_t scope_query(uint32_t frame, uint32_t scope) {
+        return frame * FRAME_QUERIES + 2 + scope * 2;
+}
+
+void gpu_timer_init() {
+        VkQueryPoolCreateInfo create_info = {
+            .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+            .queryType = VK_QUERY_TYPE_TIMESTAMP,
+            .queryCount = GPU_TIMER_MAX_FRAMES * FRAME_QUERIES,
+        };
+        VK_EXPECT(vkCreateQueryPool(vk_context_device(), &create_info, NULL, &g_gpu_timer.pool));
+}
+
+void gpu_timer_shutdown() {
+        vkDestroyQueryPool(vk_context_device(), g_gpu_timer.pool, NULL);
+        g_gpu_timer = (gpu_timer_t){0};
+}
+
+void gpu_timer_begin(VkCommandBuffer cmd, uint32_t frame) {
+        ASSERT(frame < GPU_TIMER_MAX_FRAMES);
+
+        uint32_t first = frame * FRAME_QUERIES;
+        vkCmdResetQueryPool(cmd, g_gpu_timer.pool, first, FRAME_QUERIES);
+        vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, g_gpu_timer.pool, first);
+        g_gpu_timer.recording_scopes[frame] = 0;
+}
+
+void gpu_timer_end(VkCommandBuffer cmd, uint32_t frame) {
+        vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT, g_gpu_timer.pool,
+                             frame * FRAME_QUERIES + 1);
+        g_gpu_timer.recorded[frame] = true;
+        g_gpu_timer.scope_count[frame] = g_gpu_timer.recording_scopes[frame];
+}
+
+void gpu_timer_scope_begin(VkCommandBuffer cmd, uint32_t frame, uint32_t scope) {
+        ASSERT(scope < GPU_TIMER_MAX_SCOPES);
+
+        vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, g_gpu_timer.pool,
+                             scope_query(frame, scope));
+}
+
+void gpu_timer_scope_end(VkCommandBuffer cmd, uint32_t frame, uint32_t scope) {
+        ASSERT(scope < GPU_TIMER_MAX_SCOPES);
+
+        vkCmdWriteTimestamp2(cmd, VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT, g_gpu_timer.pool,
+                             scope_query(frame, scope) + 1);
+        if (scope >= g_gpu_timer.recording_scopes[frame]) {
+                g_gpu_timer.recording_scopes[frame] = scope + 1;
+        }
+}
+
+double gpu_timer_read(uint32_t frame) {
+        if (!g_gpu_timer.recorded[frame]) {
+                return -1.0;
+        }
+
+        uint64_t timestamps[2];
+        VkResult result = vkGetQueryPoolResults(vk_context_device(), g_gpu_timer.pool,
+                                                frame * FRAME_QUERIES, 2, sizeof(timestamps),
+                                                timestamps, sizeof(uint64_t),
+                                                VK_QUERY_RESULT_64_BIT);
+        if (result != VK_SUCCESS) {
+                return -1.0;
+        }
+
+        return (timestamps[1] - timestamps[0]) * vk_context_timestamp_period() * 1e-6;
+}
+
+uint32_t gpu_timer_read_scopes(uint32_t frame, double ms[GPU_TIMER_MAX_SCOPES]) {
+        uint32_t count = g_gpu_timer.recorded[frame] ? g_gpu_timer.scope_count[frame] : 0;
+        if (count == 0) {
+                return 0;
+        }
+
+        uint64_t timestamps[GPU_TIMER_MAX_SCOPES * 2];
+        VkResult result = vkGetQueryPoolResults(
+            vk_context_device(), g_gpu_timer.pool, scope_query(frame, 0), count * 2,
+            sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+        if (result != VK_SUCCESS) {
+                return 0;
+        }
+
+        for (uint32_t s = 0; s < count; s += 1) {
+                ms[s] = (timestamps[s * 2 + 1] - timestamps[s * 2]) *
+                        vk_context_timestamp_period() * 1e-6;
+        }
+
+        return count;
+}
@@ -45,6 +45,48 @@ void image_destroy(Image *image, VkDevice device) {
         vkDestroyImageView(device, image->image_view, NULL);
 }
 
+void image_layout_scope(VkImageLayout layout, VkPipelineStageFlags2 *stages,
+                        VkAccessFlags2 *access) {
+        switch (layout) {
+        case VK_IMAGE_LAYOUT_UNDEFINED:
+        case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+                // Presentation is ordered by the render semaphore, not by the barrier
+                *stages = VK_PIPELINE_STAGE_2_NONE;
+                *access = VK_ACCESS_2_NONE;
+                break;
+        case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+                *stages = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+                *access = VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT |
+                          VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
+                break;
+        case VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL:
+        case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+                *stages = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT |
+                          VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+                *access = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT |
+                          VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+                break;
+        case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+                *stages = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT |
+                          VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT |
+                          VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+                *access = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+                break;
+        case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+                *stages = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT;
+                *access = VK_ACCESS_2_TRANSFER_READ_BIT;
+                break;
+        case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+                *stages = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT;
+                *access = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+                break;
+        default:
+                *stages = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+                *access = VK_ACCESS_2_MEMORY_READ_BIT | VK_ACCESS_2_MEMORY_WRITE_BIT;
+                break;
+        }
+}
+
 void image_transition(Image *image, VkCommandBuffer command, VkImageLayout layout) {
         VkImageAspectFlags mask = (layout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL)
                                       ? VK_IMAGE_ASPECT_DEPTH_BIT
@@ -58,12 +100,17 @@ void image_transition(Image *image, VkCommandBuffer command, VkImageLayout layou
             .layerCount = VK_REMAINING_ARRAY_LAYERS,
         };
 
+        VkPipelineStageFlags2 src_stages, dst_stages;
+        VkAccessFlags2 src_access, dst_access;
+        image_layout_scope(image->layout, &src_stages, &src_access);
+        image_layout_scope(layout, &dst_stages, &dst_access);
+
         VkImageMemoryBarrier2 barrier = {
             .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
-            .srcStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
-            .srcAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT,
-            .dstStageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
-            .dstAccessMask = VK_ACCESS_2_MEMORY_WRITE_BIT | VK_ACCESS_2_MEMORY_READ_BIT,
+            .srcStageMask = src_stages,
+            .srcAccessMask = src_access & IMAGE_WRITE_ACCESS,
+            .dstStageMask = dst_stages,
+            .dstAccessMask = dst_access,
             .oldLayout = image->layout,
             .newLayout = layout,
             .subresourceRange = range,
@@ -80,12 +127,16 @@ void image_transition(Image *image, VkCommandBuffer command, VkImageLayout layou
 }
 
 void image_blit(VkCommandBuffer command, Image *src, Image *dst) {
+        image_blit_region(command, src, (VkExtent2D){src->extent.width, src->extent.height}, dst,
+                          (VkExtent2D){dst->extent.width, dst->extent.height});
+}
+
+void image_blit_region(VkCommandBuffer command, Image *src, VkExtent2D src_extent, Image *dst,
+                       VkExtent2D dst_extent) {
         VkImageBlit2 blit = {
             .sType = VK_STRUCTURE_TYPE_IMAGE_BLIT_2,
-            .srcOffsets =
-                {{0}, {.x = src->extent.width, .y = src->extent.height, .z = src->extent.depth}},
-            .dstOffsets =
-                {{0}, {.x = dst->extent.width, .y = dst->extent.height, .z = dst->extent.depth}},
+            .srcOffsets = {{0}, {.x = src_extent.width, .y = src_extent.height, .z = 1}},
+            .dstOffsets = {{0}, {.x = dst_extent.width, .y = dst_extent.height, .z = 1}},
             .srcSubresource =
                 {
                     .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
@@ -105,9 +156,9 @@ void image_blit(VkCommandBuffer command, Image *src, Image *dst) {
         VkBlitImageInfo2 blit_info = {
             .sType = VK_STRUCTURE_TYPE_BLIT_IMAGE_INFO_2,
             .srcImage = src->image,
-            .srcImageLayout = src->layout,
+            .srcImageLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
             .dstImage = dst->image,
-            .dstImageLayout = dst->layout,
+            .dstImageLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
             .filter = VK_FILTER_LINEAR,
             .regionCount = 1,
             .pRegions = &blit,
@@ -0,0 +1,68 @@
+#include "renderer/lights.h"
+
+#include "renderer/buffer.h"
+#include "renderer/descriptors.h"
+#include "renderer/renderer.h"
+#include "renderer/swapchain.h"
+
+#include "common/array.h"
+#include "common/profiler.h"
+
+#include <string.h>
+
+typedef struct lights {
+        PointLight *lights; // array, recorded this frame
+        buffer_t cluster_buffer;
+
+        bool overflow_logged;
+} lights_t;
+
+static lights_t g_lights;
+
+void lights_init() {
+        g_lights.lights = array(PointLight);
+
+        // Per froxel light count, followed by the light indices of every froxel. Shared by all
+        // frames in flight, see the barriers in passes/light_cull.c.
+        size_t size = sizeof(uint32_t) * CLUSTER_COUNT * (1 + CLUSTER_MAX_LIGHTS);
+        buffer_create(size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY,
+                      &g_lights.cluster_buffer);
+        descriptor_write_buffer(*swapchain_global_descriptor(), &g_lights.cluster_buffer, 4, 0);
+}
+
+void lights_shutdown() {
+        buffer_destroy(&g_lights.cluster_buffer);
+        array_free(g_lights.lights);
+
+        g_lights = (lights_t){0};
+}
+
+void lights_clear() { array_clear(g_lights.lights); }
+
+void point_light_record(vec3 position, float radius, vec3 color, float intensity) {
+        PointLight light = {
+            .position = {position[0], position[1], position[2], radius},
+            .color = {color[0], color[1], color[2], intensity},
+        };
+
+        array_append(g_lights.lights, light);
+}
+
+void lights_upload() {
+        PROFILE_ZONE("lights_upload");
+
+        uint32_t count = array_length(g_lights.lights);
+        if (count > MAX_LIGHTS) {
+                if (!g_lights.overflow_logged) {
+                        ERROR("lights: %u recorded, only the first %u are drawn", count,
+                              MAX_LIGHTS);
+                        g_lights.overflow_logged = true;
+                }
+                count = MAX_LIGHTS;
+        }
+
+        LightData *data = swapchain_current_frame_get_buffer(FRAME_BUFFER_LIGHTS);
+        data->count = count;
+        memcpy(data->lights, g_lights.lights, sizeof(PointLight) * count);
+        swapchain_current_frame_unmap_buffer(FRAME_BUFFER_LIGHTS);
+}
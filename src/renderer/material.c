@@ -0,0 +1,122 @@
+#include "renderer/material.h"
+
+#include "renderer/buffer.h"
+#include "renderer/deletion_queue.h"
+#include "renderer/descriptors.h"
+#include "renderer/gpu_model.h"
+#include "renderer/swapchain.h"
+
+#include "common/id_allocator.h"
+#include "common/util.h"
+
+#include <pthread.h>
+#include <string.h>
+
+typedef struct material_entry {
+        gpu_material_t data;
+        uint64_t hash;
+        uint32_t refs; // zero while free or waiting for the GPU
+} material_entry_t;
+
+typedef struct material_table {
+        buffer_t buffer;
+        material_entry_t entries[MATERIAL_MAX];
+
+        pthread_mutex_t lock;
+        id_allocator_t ids;
+} material_table_t;
+
+static material_table_t g_materials = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+void material_table_init() {
+        g_materials.ids = id_allocator_create(MATERIAL_MAX);
+
+        buffer_create(sizeof(gpu_material_t) * MATERIAL_MAX, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                      VMA_MEMORY_USAGE_CPU_TO_GPU, &g_materials.buffer);
+        descriptor_write_buffer(*swapchain_global_descriptor(), &g_materials.buffer, 2, 0);
+}
+
+void material_table_shutdown() {
+        buffer_destroy(&g_materials.buffer);
+        id_allocator_destroy(&g_materials.ids);
+
+        memset(g_materials.entries, 0, sizeof(g_materials.entries));
+}
+
+static void material_textures_release(const gpu_material_t *material) {
+        for (int t = 0; t < MATERIAL_TEXTURE_COUNT; t += 1) {
+                if (material->textures[t] != MATERIAL_NO_TEXTURE) {
+                        gpu_unload_texture(material->textures[t]);
+                }
+        }
+}
+
+uint32_t material_create(const gpu_material_t *material) {
+        uint64_t hash = hash_bytes(material, sizeof(gpu_material_t), HASH_SEED);
+
+        pthread_mutex_lock(&g_materials.lock);
+
+        // Materials are created at load time, a linear search is fine
+        for (uint32_t id = 0; id_allocator_issued(&g_materials.ids, id); id += 1) {
+                material_entry_t *entry = &g_materials.entries[id];
+                if (entry->refs && entry->hash == hash &&
+                    memcmp(&entry->data, material, sizeof(gpu_material_t)) == 0) {
+                        entry->refs += 1;
+                        pthread_mutex_unlock(&g_materials.lock);
+
+                        material_textures_release(material);
+                        return id;
+                }
+        }
+
+        uint32_t id = id_allocator_acquire(&g_materials.ids);
+        g_materials.entries[id] = (material_entry_t){
+            .data = *material,
+            .hash = hash,
+            .refs = 1,
+        };
+
+        // Nothing in flight refers to an unused entry, it can be written while frames render
+        VK_EXPECT(vmaCopyMemoryToAllocation(vk_memory_allocator(), material,
+                                            g_materials.buffer.allocation,
+                                            sizeof(gpu_material_t) * id, sizeof(gpu_material_t)));
+
+        pthread_mutex_unlock(&g_materials.lock);
+
+        return id;
+}
+
+void material_retain(uint32_t material) {
+        pthread_mutex_lock(&g_materials.lock);
+        ASSERT(g_materials.entries[material].refs);
+        g_materials.entries[material].refs += 1;
+        pthread_mutex_unlock(&g_materials.lock);
+}
+
+static void material_id_release(uint64_t id) {
+        pthread_mutex_lock(&g_materials.lock);
+        id_allocator_release(&g_materials.ids, (uint32_t)id);
+        pthread_mutex_unlock(&g_materials.lock);
+}
+
+void material_release(uint32_t material) {
+        pthread_mutex_lock(&g_materials.lock);
+        material_entry_t *entry = &g_materials.entries[material];
+        ASSERT(entry->refs);
+        entry->refs -= 1;
+        bool last = entry->refs == 0;
+        pthread_mutex_unlock(&g_materials.lock);
+
+        if (last) {
+                material_textures_release(&entry->data);
+                deletion_queue_retire(material_id_release, material);
+        }
+}
+
+id_allocator_stats_t material_stats() {
+        pthread_mutex_lock(&g_materials.lock);
+        id_allocator_stats_t stats = id_allocator_stats(&g_materials.ids);
+        pthread_mutex_unlock(&g_materials.lock);
+
+        return stats;
+}
@@ -2,6 +2,7 @@
 
 #include "common/array.h"
 #include "common/log.h"
+#include "common/profiler.h"
 #include "common/str.h"
 
 #define STB_IMAGE_IMPLEMENTATION
@@ -21,8 +22,10 @@ static void mesh_free(mesh_t *mesh) {
 }
 
 static void material_info_destroy(material_info_t *mat) {
-        if (mat->diffuse_tex)
-                free(mat->diffuse_tex);
+        for (int t = 0; t < MATERIAL_TEXTURE_COUNT; t += 1) {
+                if (mat->textures[t].pixels)
+                        free(mat->textures[t].pixels);
+        }
 }
 
 static void process_mesh(const struct aiMesh *mesh, const struct aiScene *scene, model_t *model) {
@@ -84,52 +87,74 @@ static void process_node(const struct aiNode *node, const struct aiScene *scene,
         }
 }
 
+// Loads the first texture of `type` relative to `dir`, returns false if the material has none
+static bool load_texture(const struct aiMaterial *mat, enum aiTextureType type, Str dir,
+                         texture_data_t *texture) {
+        if (aiGetMaterialTextureCount(mat, type) == 0) {
+                return false;
+        }
+
+        struct aiString path;
+        if (aiGetMaterialString(mat, AI_MATKEY_TEXTURE(type, 0), &path) != aiReturn_SUCCESS) {
+                return false;
+        }
+
+        char *tex_path = malloc(dir.len + path.length + 2);
+        memcpy(tex_path, dir.data, dir.len);
+        tex_path[dir.len] = '/';
+        memcpy(tex_path + dir.len + 1, path.data, path.length);
+        tex_path[dir.len + path.length + 1] = '\0';
+
+        int x, y, num_channels;
+        stbi_set_flip_vertically_on_load(1);
+        texture->pixels = (char *)stbi_load(tex_path, &x, &y, &num_channels, 4);
+
+        if (texture->pixels == NULL) {
+                ERROR("failed to load image %s: %s", tex_path, stbi_failure_reason());
+                exit(1);
+        }
+
+        texture->width = (size_t)x;
+        texture->height = (size_t)y;
+
+        free(tex_path);
+        return true;
+}
+
 static void process_material(const struct aiMaterial *mat, Str dir, model_t *model) {
-        material_info_t info;
-
-        info.ambient[0] = 1.0f;
-        info.ambient[1] = 1.0f;
-        info.ambient[2] = 1.0f;
-
-        info.specular[0] = 0.5f;
-        info.specular[1] = 0.5f;
-        info.specular[2] = 0.5f;
-
-        int num_diffuse = aiGetMaterialTextureCount(mat, aiTextureType_DIFFUSE);
-        if (num_diffuse == 1) {
-                struct aiString path;
-                enum aiReturn r =
-                    aiGetMaterialString(mat, AI_MATKEY_TEXTURE(aiTextureType_DIFFUSE, 0), &path);
-
-                char *tex_path = malloc(dir.len + path.length + 2);
-                memcpy(tex_path, dir.data, dir.len);
-                tex_path[dir.len] = '/';
-                memcpy(tex_path + dir.len + 1, path.data, path.length);
-                tex_path[dir.len + path.length + 1] = '\0';
-
-                int x, y, num_channels;
-                stbi_set_flip_vertically_on_load(1);
-                info.diffuse_tex = (char *)stbi_load(tex_path, &x, &y, &num_channels, 4);
-
-                if (info.diffuse_tex == NULL) {
-                        ERROR("failed to load image: %s", stbi_failure_reason());
-                        exit(1);
-                }
+        material_info_t info = {
+            .base_color = {1.0f, 1.0f, 1.0f, 1.0f},
+            .metallic = 0.0f,
+            .roughness = 1.0f,
+        };
+
+        struct aiColor4D color;
+        if (aiGetMaterialColor(mat, AI_MATKEY_BASE_COLOR, &color) == aiReturn_SUCCESS ||
+            aiGetMaterialColor(mat, AI_MATKEY_COLOR_DIFFUSE, &color) == aiReturn_SUCCESS) {
+                glm_vec4_copy((vec4){color.r, color.g, color.b, color.a}, info.base_color);
+        }
+        aiGetMaterialFloatArray(mat, AI_MATKEY_METALLIC_FACTOR, &info.metallic, NULL);
+        aiGetMaterialFloatArray(mat, AI_MATKEY_ROUGHNESS_FACTOR, &info.roughness, NULL);
 
-                info.diffuse_width = (size_t)x;
-                info.diffuse_height = (size_t)y;
+        texture_data_t *base_color = &info.textures[MATERIAL_TEXTURE_BASE_COLOR];
+        if (!load_texture(mat, aiTextureType_BASE_COLOR, dir, base_color)) {
+                load_texture(mat, aiTextureType_DIFFUSE, dir, base_color);
+        }
 
-                free(tex_path);
-        } else {
-                DEBUG("Material Diffuse count: %d", num_diffuse);
+        load_texture(mat, aiTextureType_NORMALS, dir, &info.textures[MATERIAL_TEXTURE_NORMAL]);
 
-                info.diffuse_tex = NULL;
+        // glTF packs both into one map, older importers expose it as an unknown texture
+        texture_data_t *metal_roughness = &info.textures[MATERIAL_TEXTURE_METAL_ROUGHNESS];
+        if (!load_texture(mat, aiTextureType_METALNESS, dir, metal_roughness)) {
+                load_texture(mat, aiTextureType_UNKNOWN, dir, metal_roughness);
         }
 
         array_append(model->materials, info);
 }
 
 model_t load_model(char *filename) {
+        PROFILE_ZONE("load_model");
+
         Str path = str_span(filename, filename + strlen(filename));
         Str dir = make_cutr(path, '/').head;
 
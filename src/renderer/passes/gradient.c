@@ -4,8 +4,6 @@
 #include "renderer/pipeline.h"
 #include "renderer/vk_context.h"
 
-#include "common/util.h"
-
 typedef struct gradient_pass {
         compute_pipeline_t pipeline;
         DescriptorLayout pass_layout;
@@ -17,7 +15,8 @@ typedef struct gradient_pass {
 
 static gradient_pass_t g_gradient_pass;
 
-static void gradient_callback(VkCommandBuffer cmd);
+static void gradient_callback(VkCommandBuffer cmd, uint32_t chunk, uint32_t chunk_count);
+static void gradient_pass_setup();
 static void gradient_pass_cleanup();
 
 void gradient_pass_register(render_graph_t *graph, attachment_handle_t image) {
@@ -30,32 +29,23 @@ void gradient_pass_register(render_graph_t *graph, attachment_handle_t image) {
              .stage = VK_SHADER_STAGE_COMPUTE_BIT},
         };
 
-        descriptor_allocator_reserve(draw_image_bindings, 1, false);
+        // Budgeted by the descriptor pool, see pass_descriptors_reserve()
         g_gradient_pass.pass_layout =
             descriptor_layout_create(vk_context_device(), draw_image_bindings, 1);
 
-        g_gradient_pass.pass_descriptor = descriptor_allocate(&g_gradient_pass.pass_layout);
-
-        descriptor_write_image(g_gradient_pass.pass_descriptor,
-                               render_graph_attachment_image(graph, image), 0, 0);
-
-        size_t gradient_size;
-        char *gradient_comp = ReadFile("shaders/gradient2.comp.spv", &gradient_size);
-
         uint32_t sizes[] = {sizeof(float) * 16};
         comnpute_pipeline_config_t pipeline_info = {
             .descriptors = &g_gradient_pass.pass_layout.layout,
             .num_descriptors = 1,
             .push_constant_sizes = sizes,
             .num_push_constant_sizes = 1,
-            .shader_source = (const uint32_t *)gradient_comp,
-            .shader_source_size = gradient_size / 4,
         };
-        g_gradient_pass.pipeline = compute_pipeline_create(vk_context_device(), &pipeline_info);
-        free(gradient_comp);
+        pipeline_queue_compute(&pipeline_info, "gradient2.comp", &g_gradient_pass.pipeline);
 
         render_pass_t pass = {
+            .name = "gradient",
             .record = gradient_callback,
+            .setup = gradient_pass_setup,
             .cleanup = gradient_pass_cleanup,
             .attachment_count = 1,
             .attachments = {image},
@@ -65,7 +55,7 @@ void gradient_pass_register(render_graph_t *graph, attachment_handle_t image) {
         render_graph_register_pass(graph, pass);
 }
 
-static void gradient_callback(VkCommandBuffer cmd) {
+static void gradient_callback(VkCommandBuffer cmd, uint32_t chunk, uint32_t chunk_count) {
         vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, g_gradient_pass.pipeline.pipeline);
         vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
                                 g_gradient_pass.pipeline.layout, 0, 1,
@@ -83,10 +73,22 @@ static void gradient_callback(VkCommandBuffer cmd) {
         vkCmdPushConstants(cmd, g_gradient_pass.pipeline.layout, VK_SHADER_STAGE_COMPUTE_BIT, 0,
                            sizeof(pc), &pc);
 
-        Image *image =
-            render_graph_attachment_image(g_gradient_pass.graph, g_gradient_pass.image_ref);
-        vkCmdDispatch(cmd, ceilf(image->extent.width / 16.0f), ceilf(image->extent.height / 16.0f),
-                      1);
+        VkExtent2D extent =
+            render_graph_render_extent(g_gradient_pass.graph, g_gradient_pass.image_ref);
+        vkCmdDispatch(cmd, ceilf(extent.width / 16.0f), ceilf(extent.height / 16.0f), 1);
+}
+
+static void gradient_pass_setup() {
+        // Called again on resize, when frames in flight may still use the set. Sets can't be
+        // written while pending command buffers use them, so every image gets a new one.
+        if (g_gradient_pass.pass_descriptor.descriptor) {
+                descriptor_retire(&g_gradient_pass.pass_descriptor);
+        }
+        g_gradient_pass.pass_descriptor = descriptor_allocate(&g_gradient_pass.pass_layout);
+
+        descriptor_write_image(
+            g_gradient_pass.pass_descriptor,
+            render_graph_attachment_image(g_gradient_pass.graph, g_gradient_pass.image_ref), 0, 0);
 }
 
 static void gradient_pass_cleanup() {
@@ -0,0 +1,87 @@
+#include "renderer/render_passes.h"
+
+#include "renderer/descriptors.h"
+#include "renderer/lights.h"
+#include "renderer/pipeline.h"
+#include "renderer/swapchain.h"
+#include "renderer/vk_context.h"
+
+#define WORKGROUP_SIZE 64
+
+typedef struct light_cull_pass {
+        compute_pipeline_t pipeline;
+} light_cull_pass_t;
+
+static light_cull_pass_t g_light_cull_pass;
+
+static void light_cull_callback(VkCommandBuffer cmd, uint32_t chunk, uint32_t chunk_count);
+static void light_cull_pass_cleanup();
+
+void light_cull_pass_register(render_graph_t *graph) {
+        VkDescriptorSetLayout layouts[] = {global_descriptor_layout()->layout};
+        comnpute_pipeline_config_t pipeline_info = {
+            .descriptors = layouts,
+            .num_descriptors = 1,
+        };
+        pipeline_queue_compute(&pipeline_info, "light_cull.comp", &g_light_cull_pass.pipeline);
+
+        // The clusters are a buffer, which the graph doesn't track, so the pass places its own
+        // barriers and has no attachments
+        render_pass_t pass = {
+            .name = "light_cull",
+            .record = light_cull_callback,
+            .cleanup = light_cull_pass_cleanup,
+        };
+
+        render_graph_register_pass(graph, pass);
+}
+
+static void cluster_barrier(VkCommandBuffer cmd, VkPipelineStageFlags2 src_stage,
+                            VkAccessFlags2 src_access, VkPipelineStageFlags2 dst_stage,
+                            VkAccessFlags2 dst_access) {
+        VkMemoryBarrier2 barrier = {
+            .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2,
+            .srcStageMask = src_stage,
+            .srcAccessMask = src_access,
+            .dstStageMask = dst_stage,
+            .dstAccessMask = dst_access,
+        };
+
+        VkDependencyInfo dependency = {
+            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+            .memoryBarrierCount = 1,
+            .pMemoryBarriers = &barrier,
+        };
+
+        vkCmdPipelineBarrier2(cmd, &dependency);
+}
+
+static void light_cull_callback(VkCommandBuffer cmd, uint32_t chunk, uint32_t chunk_count) {
+        // The clusters are one buffer shared by every frame in flight. The previous frame's
+        // fragment shaders may still be reading them, and this barrier only orders against that
+        // because both frames are submitted to the same queue. Moving the pass to an async
+        // compute queue needs a buffer per frame, or a semaphore, instead.
+        cluster_barrier(cmd, VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, 0,
+                        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, 0);
+
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
+                          g_light_cull_pass.pipeline.pipeline);
+
+        uint32_t offsets[GLOBAL_DYNAMIC_OFFSETS];
+        swapchain_current_frame_global_offsets(offsets);
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
+                                g_light_cull_pass.pipeline.layout, 0, 1,
+                                &swapchain_global_descriptor()->descriptor,
+                                GLOBAL_DYNAMIC_OFFSETS, offsets);
+
+        vkCmdDispatch(cmd, (CLUSTER_COUNT + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+        cluster_barrier(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+                        VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+                        VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+                        VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+}
+
+static void light_cull_pass_cleanup() {
+        compute_pipeline_destroy(&g_light_cull_pass.pipeline, vk_context_device());
+}
@@ -1,5 +1,6 @@
 #include "renderer/render_passes.h"
 
+#include "renderer/bindless.h"
 #include "renderer/descriptors.h"
 #include "renderer/draw.h"
 #include "renderer/pipeline.h"
@@ -7,8 +8,6 @@
 #include "renderer/swapchain.h"
 #include "renderer/vk_context.h"
 
-#include "common/util.h"
-
 typedef struct pbr_pass {
         graphics_pipeline_t pipeline;
         attachment_handle_t hdr;
@@ -18,7 +17,7 @@ typedef struct pbr_pass {
 static pbr_pass_t g_pbr_pass;
 
 static void pbr_pipeline_init(VkFormat format);
-static void pbr_callback(VkCommandBuffer cmd);
+static void pbr_callback(VkCommandBuffer cmd, uint32_t chunk, uint32_t chunk_count);
 static void pbr_pass_cleanup();
 
 void pbr_pass_register(render_graph_t *graph, attachment_handle_t hdr, attachment_handle_t depth) {
@@ -28,7 +27,9 @@ void pbr_pass_register(render_graph_t *graph, attachment_handle_t hdr, attachmen
         pbr_pipeline_init(render_graph_attachment_format(graph, hdr));
 
         render_pass_t pass = {
+            .name = "pbr",
             .record = pbr_callback,
+            .chunk_count = draw_batches_chunk_count,
             .cleanup = pbr_pass_cleanup,
             .attachment_count = 2,
             .attachments = {hdr, depth},
@@ -48,20 +49,13 @@ static void pbr_pipeline_init(VkFormat format) {
             },
         };
 
-        size_t vert_size, frag_size;
-        char *vert = ReadFile("shaders/pbr.vert.spv", &vert_size);
-        char *frag = ReadFile("shaders/pbr.frag.spv", &frag_size);
-
-        VkDescriptorSetLayout layouts[] = {global_descriptor_layout()->layout};
+        VkDescriptorSetLayout layouts[] = {global_descriptor_layout()->layout,
+                                           bindless_layout()->layout};
         graphics_pipeline_config_t mesh_pipeline_info = {
             .descriptors = layouts,
-            .num_descriptors = 1,
+            .num_descriptors = 2,
             .push_constants = push_constants,
             .num_push_constants = 1,
-            .vertex_shader = (const uint32_t *)vert,
-            .vertex_shader_size = vert_size / 4,
-            .fragment_shader = (const uint32_t *)frag,
-            .fragment_shader_size = frag_size / 4,
             .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
             .polygon_mode = VK_POLYGON_MODE_FILL,
             .cull_mode = VK_CULL_MODE_BACK_BIT,
@@ -71,20 +65,22 @@ static void pbr_pipeline_init(VkFormat format) {
             .depth_testing = true,
             .depth_compare_op = VK_COMPARE_OP_LESS,
         };
-        g_pbr_pass.pipeline = graphics_pipeline_create(vk_context_device(), &mesh_pipeline_info);
-
-        free(vert);
-        free(frag);
+        pipeline_queue_graphics(&mesh_pipeline_info, "pbr.vert", "pbr.frag", &g_pbr_pass.pipeline);
 }
 
-static void pbr_callback(VkCommandBuffer cmd) {
+static void pbr_callback(VkCommandBuffer cmd, uint32_t chunk, uint32_t chunk_count) {
+        VkDescriptorSet sets[] = {
+            swapchain_global_descriptor()->descriptor,
+            bindless_descriptor()->descriptor,
+        };
+        uint32_t offsets[GLOBAL_DYNAMIC_OFFSETS];
+        swapchain_current_frame_global_offsets(offsets);
         vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, g_pbr_pass.pipeline.layout, 0,
-                                1, &swapchain_current_frame_global_descriptor()->descriptor, 0,
-                                NULL);
+                                2, sets, GLOBAL_DYNAMIC_OFFSETS, offsets);
 
         vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, g_pbr_pass.pipeline.pipeline);
 
-        draw_batches_record();
+        draw_batches_record(cmd, chunk, chunk_count);
 }
 
 static void pbr_pass_cleanup() {
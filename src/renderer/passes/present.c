@@ -10,11 +10,14 @@ typedef struct present_pass_t {
 
 static present_pass_t g_present_pass;
 
-static void present_callback(VkCommandBuffer cmd) {
+static void present_callback(VkCommandBuffer cmd, uint32_t chunk, uint32_t chunk_count) {
         Image *src = render_graph_attachment_image(g_present_pass.graph, g_present_pass.image);
         Image *dst = render_graph_attachment_image(g_present_pass.graph, ATTACHMENT_BACKBUFFER);
 
-        image_blit(swapchain_current_frame_command_buffer(), src, dst);
+        // Upscales when rendering below output resolution
+        render_graph_t *graph = g_present_pass.graph;
+        image_blit_region(cmd, src, render_graph_render_extent(graph, g_present_pass.image), dst,
+                          render_graph_render_extent(graph, ATTACHMENT_BACKBUFFER));
 }
 
 void present_pass_register(render_graph_t *graph, attachment_handle_t image) {
@@ -22,6 +25,7 @@ void present_pass_register(render_graph_t *graph, attachment_handle_t image) {
         g_present_pass.graph = graph;
 
         render_pass_t pass = {
+            .name = "present",
             .record = present_callback,
             .attachment_count = 2,
             .attachments = {image, ATTACHMENT_BACKBUFFER},
@@ -0,0 +1,88 @@
+#include "renderer/render_passes.h"
+
+#include "renderer/bindless.h"
+#include "renderer/descriptors.h"
+#include "renderer/pipeline.h"
+#include "renderer/render_graph.h"
+#include "renderer/swapchain.h"
+#include "renderer/terrain.h"
+#include "renderer/visibility.h"
+#include "renderer/vk_context.h"
+
+typedef struct terrain_pass {
+        graphics_pipeline_t pipeline;
+} terrain_pass_t;
+
+static terrain_pass_t g_terrain_pass;
+
+static void terrain_pipeline_init(VkFormat format);
+static void terrain_callback(VkCommandBuffer cmd, uint32_t chunk, uint32_t chunk_count);
+static void terrain_pass_cleanup();
+
+void terrain_pass_register(render_graph_t *graph, attachment_handle_t hdr,
+                           attachment_handle_t depth) {
+        terrain_pipeline_init(render_graph_attachment_format(graph, hdr));
+
+        render_pass_t pass = {
+            .name = "terrain",
+            .record = terrain_callback,
+            .cleanup = terrain_pass_cleanup,
+            .attachment_count = 2,
+            .attachments = {hdr, depth},
+            .attachment_states = {VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                                  VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL},
+        };
+
+        render_graph_register_pass(graph, pass);
+}
+
+static void terrain_pipeline_init(VkFormat format) {
+        VkPushConstantRange push_constants[] = {
+            {
+                .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+                .offset = 0,
+                .size = 32,
+            },
+        };
+
+        VkDescriptorSetLayout layouts[] = {global_descriptor_layout()->layout,
+                                           bindless_layout()->layout,
+                                           visibility_gpu_layout()->layout};
+        graphics_pipeline_config_t terrain_pipeline_info = {
+            .descriptors = layouts,
+            .num_descriptors = 3,
+            .push_constants = push_constants,
+            .num_push_constants = 1,
+            .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
+            .polygon_mode = VK_POLYGON_MODE_FILL,
+            .cull_mode = VK_CULL_MODE_BACK_BIT,
+            .front_face = VK_FRONT_FACE_COUNTER_CLOCKWISE,
+            .color_attachment_format = format,
+            .depth_attachment_format = VK_FORMAT_D32_SFLOAT,
+            .depth_testing = true,
+            .depth_compare_op = VK_COMPARE_OP_LESS,
+        };
+        pipeline_queue_graphics(&terrain_pipeline_info, "terrain.vert", "terrain.frag",
+                                &g_terrain_pass.pipeline);
+}
+
+static void terrain_callback(VkCommandBuffer cmd, uint32_t chunk, uint32_t chunk_count) {
+        VkDescriptorSet sets[] = {
+            swapchain_global_descriptor()->descriptor,
+            bindless_descriptor()->descriptor,
+            visibility_gpu_descriptor()->descriptor,
+        };
+        uint32_t offsets[GLOBAL_DYNAMIC_OFFSETS];
+        swapchain_current_frame_global_offsets(offsets);
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                g_terrain_pass.pipeline.layout, 0, 3, sets, GLOBAL_DYNAMIC_OFFSETS,
+                                offsets);
+
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, g_terrain_pass.pipeline.pipeline);
+
+        terrain_record(cmd, g_terrain_pass.pipeline.layout);
+}
+
+static void terrain_pass_cleanup() {
+        graphics_pipeline_destroy(&g_terrain_pass.pipeline, vk_context_device());
+}
@@ -1,6 +1,38 @@
 #include "renderer/pipeline.h"
 
+#include "renderer/pipeline_cache.h"
+#include "renderer/shaders.h"
+#include "renderer/vk_context.h"
+
+#include "common/array.h"
+#include "common/job.h"
+#include "common/profiler.h"
+
 #include <stdlib.h>
+#include <string.h>
+
+typedef enum pipeline_build_type {
+        PIPELINE_BUILD_GRAPHICS,
+        PIPELINE_BUILD_COMPUTE,
+} pipeline_build_type_t;
+
+typedef struct pipeline_build {
+        pipeline_build_type_t type;
+        union {
+                graphics_pipeline_config_t graphics;
+                comnpute_pipeline_config_t compute;
+        };
+        void *out;
+
+        // Copies of the config's arrays, the config is pointed at them when the build runs
+        VkDescriptorSetLayout descriptors[PIPELINE_BUILD_MAX_DESCRIPTORS];
+        VkPushConstantRange push_constants[PIPELINE_BUILD_MAX_PUSH_CONSTANTS];
+        uint32_t push_constant_sizes[PIPELINE_BUILD_MAX_PUSH_CONSTANTS];
+
+        const char *shader_names[2];
+} pipeline_build_t;
+
+static pipeline_build_t *g_pipeline_builds; // array
 
 static void create_shader_module(VkDevice device, const uint32_t *bytes, size_t len,
                                  VkShaderModule *module) {
@@ -138,7 +170,7 @@ graphics_pipeline_t graphics_pipeline_create(VkDevice device,
             .pNext = &render_info,
         };
 
-        VK_EXPECT(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipeline_info, NULL,
+        VK_EXPECT(vkCreateGraphicsPipelines(device, pipeline_cache(), 1, &pipeline_info, NULL,
                                             &p.pipeline));
 
         vkDestroyShaderModule(device, vertex, NULL);
@@ -196,8 +228,8 @@ compute_pipeline_t compute_pipeline_create(VkDevice device, comnpute_pipeline_co
             .layout = p.layout,
         };
 
-        result =
-            vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipeline_info, NULL, &p.pipeline);
+        result = vkCreateComputePipelines(device, pipeline_cache(), 1, &pipeline_info, NULL,
+                                          &p.pipeline);
         vkDestroyShaderModule(device, compute, NULL);
         VK_EXPECT(result);
 
@@ -208,3 +240,106 @@ void compute_pipeline_destroy(compute_pipeline_t *p, VkDevice device) {
         vkDestroyPipelineLayout(device, p->layout, NULL);
         vkDestroyPipeline(device, p->pipeline, NULL);
 }
+
+///////////////////////////////////////
+/// Pipeline Builds
+///////////////////////////////////////
+
+static pipeline_build_t *pipeline_build_append(pipeline_build_type_t type, void *out,
+                                               VkDescriptorSetLayout *descriptors,
+                                               uint32_t num_descriptors) {
+        ASSERT(num_descriptors <= PIPELINE_BUILD_MAX_DESCRIPTORS);
+
+        if (!g_pipeline_builds) {
+                g_pipeline_builds = array(pipeline_build_t);
+        }
+
+        pipeline_build_t build = {.type = type, .out = out};
+        memcpy(build.descriptors, descriptors, num_descriptors * sizeof(VkDescriptorSetLayout));
+        array_append(g_pipeline_builds, build);
+
+        return &g_pipeline_builds[array_length(g_pipeline_builds) - 1];
+}
+
+void pipeline_queue_graphics(const graphics_pipeline_config_t *config, const char *vertex_shader,
+                             const char *fragment_shader, graphics_pipeline_t *out) {
+        ASSERT(config->num_push_constants <= PIPELINE_BUILD_MAX_PUSH_CONSTANTS);
+
+        pipeline_build_t *build = pipeline_build_append(PIPELINE_BUILD_GRAPHICS, out,
+                                                        config->descriptors,
+                                                        config->num_descriptors);
+        build->graphics = *config;
+        memcpy(build->push_constants, config->push_constants,
+               config->num_push_constants * sizeof(VkPushConstantRange));
+        build->shader_names[0] = vertex_shader;
+        build->shader_names[1] = fragment_shader;
+}
+
+void pipeline_queue_compute(const comnpute_pipeline_config_t *config, const char *shader,
+                            compute_pipeline_t *out) {
+        ASSERT(config->num_push_constant_sizes <= PIPELINE_BUILD_MAX_PUSH_CONSTANTS);
+
+        pipeline_build_t *build = pipeline_build_append(PIPELINE_BUILD_COMPUTE, out,
+                                                        config->descriptors,
+                                                        config->num_descriptors);
+        build->compute = *config;
+        memcpy(build->push_constant_sizes, config->push_constant_sizes,
+               config->num_push_constant_sizes * sizeof(uint32_t));
+        build->shader_names[0] = shader;
+}
+
+// Shader modules, layouts and pipelines can all be created concurrently, and the pipeline cache
+// is internally synchronized
+static void pipeline_build_job(void *data, uint32_t index, uint32_t worker) {
+        (void)data;
+        (void)worker;
+        PROFILE_ZONE("pipeline_build");
+
+        pipeline_build_t *build = &g_pipeline_builds[index];
+        VkDevice device = vk_context_device();
+
+        if (build->type == PIPELINE_BUILD_GRAPHICS) {
+                shader_code_t vertex = shader_load(build->shader_names[0]);
+                shader_code_t fragment = shader_load(build->shader_names[1]);
+
+                graphics_pipeline_config_t *config = &build->graphics;
+                config->descriptors = build->descriptors;
+                config->push_constants = build->push_constants;
+                config->vertex_shader = vertex.code;
+                config->vertex_shader_size = vertex.size;
+                config->fragment_shader = fragment.code;
+                config->fragment_shader_size = fragment.size;
+
+                *(graphics_pipeline_t *)build->out = graphics_pipeline_create(device, config);
+
+                shader_release(&vertex);
+                shader_release(&fragment);
+        } else {
+                shader_code_t shader = shader_load(build->shader_names[0]);
+
+                comnpute_pipeline_config_t *config = &build->compute;
+                config->descriptors = build->descriptors;
+                config->push_constant_sizes = build->push_constant_sizes;
+                config->shader_source = shader.code;
+                config->shader_source_size = shader.size;
+
+                *(compute_pipeline_t *)build->out = compute_pipeline_create(device, config);
+
+                shader_release(&shader);
+        }
+}
+
+void pipelines_build() {
+        if (!g_pipeline_builds) {
+                return;
+        }
+
+        PROFILE_ZONE("pipelines_build");
+
+        uint32_t count = array_length(g_pipeline_builds);
+        jobs_parallel_for(count, pipeline_build_job, NULL);
+        DEBUG("pipelines: built %u pipelines", count);
+
+        array_free(g_pipeline_builds);
+        g_pipeline_builds = NULL;
+}
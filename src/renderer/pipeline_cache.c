@@ -0,0 +1,184 @@
+#include "renderer/pipeline_cache.h"
+
+#include "renderer/vk_context.h"
+
+#include "common/util.h"
+
+#include "husky.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define PIPELINE_CACHE_MAGIC 0x48504331u // "HPC1"
+#define PIPELINE_CACHE_VERSION 1
+
+// Prepended to the driver's cache data. The driver's own header has the UUID but not the driver
+// version, and some drivers accept stale data silently.
+typedef struct pipeline_cache_header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vendor_id;
+        uint32_t device_id;
+        uint32_t driver_version;
+        uint8_t uuid[VK_UUID_SIZE];
+        uint64_t data_size;
+        uint64_t checksum;
+} pipeline_cache_header_t;
+
+typedef struct pipeline_cache_state {
+        VkPipelineCache cache;
+        char *path;
+} pipeline_cache_state_t;
+
+static pipeline_cache_state_t g_pipeline_cache;
+
+static pipeline_cache_header_t device_header() {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(vk_context_physical_device(), &properties);
+
+        pipeline_cache_header_t header = {
+            .magic = PIPELINE_CACHE_MAGIC,
+            .version = PIPELINE_CACHE_VERSION,
+            .vendor_id = properties.vendorID,
+            .device_id = properties.deviceID,
+            .driver_version = properties.driverVersion,
+        };
+        memcpy(header.uuid, properties.pipelineCacheUUID, VK_UUID_SIZE);
+
+        return header;
+}
+
+static bool header_matches(const pipeline_cache_header_t *file,
+                           const pipeline_cache_header_t *device) {
+        return file->magic == device->magic && file->version == device->version &&
+               file->vendor_id == device->vendor_id && file->device_id == device->device_id &&
+               file->driver_version == device->driver_version &&
+               memcmp(file->uuid, device->uuid, VK_UUID_SIZE) == 0;
+}
+
+// Returns the cache data if the file exists and was written for this device, NULL otherwise
+static void *read_cache_file(const char *path, size_t *size) {
+        FILE *f = fopen(path, "rb");
+        if (!f) {
+                return NULL;
+        }
+
+        pipeline_cache_header_t header;
+        pipeline_cache_header_t device = device_header();
+        void *data = NULL;
+
+        if (fread(&header, sizeof(header), 1, f) != 1 || !header_matches(&header, &device)) {
+                INFO("pipeline cache: %s is stale or from another device, ignoring it", path);
+                goto done;
+        }
+
+        // The size comes from the file, check it against what is actually there before trusting it
+        long start = ftell(f);
+        if (start < 0 || fseek(f, 0, SEEK_END) != 0) {
+                INFO("pipeline cache: failed to read %s, ignoring it", path);
+                goto done;
+        }
+        long end = ftell(f);
+        if (end < start || (uint64_t)(end - start) != header.data_size ||
+            fseek(f, start, SEEK_SET) != 0) {
+                INFO("pipeline cache: %s is truncated or oversized, ignoring it", path);
+                goto done;
+        }
+
+        data = malloc(header.data_size);
+        if (!data) {
+                ERROR("pipeline cache: failed to allocate %llu bytes for %s",
+                      (unsigned long long)header.data_size, path);
+                goto done;
+        }
+
+        // Checksummed only to catch corrupted files
+        if (fread(data, 1, header.data_size, f) != header.data_size ||
+            hash_bytes(data, header.data_size, HASH_SEED) != header.checksum) {
+                INFO("pipeline cache: %s is corrupt, ignoring it", path);
+                free(data);
+                data = NULL;
+                goto done;
+        }
+
+        *size = header.data_size;
+
+done:
+        fclose(f);
+        return data;
+}
+
+static void write_cache_file(const char *path, const void *data, size_t size) {
+        pipeline_cache_header_t header = device_header();
+        header.data_size = size;
+        header.checksum = hash_bytes(data, size, HASH_SEED);
+
+        // Written next to the destination and renamed over it, so a crash never leaves a
+        // half-written cache behind
+        size_t path_length = strlen(path);
+        char *tmp_path = malloc(path_length + 5);
+        ASSERT(tmp_path);
+        memcpy(tmp_path, path, path_length);
+        memcpy(tmp_path + path_length, ".tmp", 5);
+
+        FILE *f = fopen(tmp_path, "wb");
+        if (!f) {
+                ERROR("pipeline cache: failed to open %s", tmp_path);
+                free(tmp_path);
+                return;
+        }
+
+        bool ok = fwrite(&header, sizeof(header), 1, f) == 1 && fwrite(data, 1, size, f) == size &&
+                  fflush(f) == 0 && fsync(fileno(f)) == 0;
+        ok = fclose(f) == 0 && ok;
+
+        if (ok && rename(tmp_path, path) == 0) {
+                DEBUG("pipeline cache: wrote %zu bytes to %s", size, path);
+        } else {
+                ERROR("pipeline cache: failed to write %s", path);
+                remove(tmp_path);
+        }
+
+        free(tmp_path);
+}
+
+void pipeline_cache_init(const char *path) {
+        size_t size = 0;
+        void *data = read_cache_file(path, &size);
+
+        VkPipelineCacheCreateInfo create_info = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+            .initialDataSize = size,
+            .pInitialData = data,
+        };
+        VK_EXPECT(vkCreatePipelineCache(vk_context_device(), &create_info, NULL,
+                                        &g_pipeline_cache.cache));
+        free(data);
+
+        g_pipeline_cache.path = strdup(path);
+
+        DEBUG("pipeline cache: loaded %zu bytes from %s", size, path);
+}
+
+void pipeline_cache_shutdown() {
+        VkDevice device = vk_context_device();
+
+        size_t size = 0;
+        VK_EXPECT(vkGetPipelineCacheData(device, g_pipeline_cache.cache, &size, NULL));
+
+        void *data = malloc(size);
+        VkResult result = vkGetPipelineCacheData(device, g_pipeline_cache.cache, &size, data);
+        if (result == VK_SUCCESS) {
+                write_cache_file(g_pipeline_cache.path, data, size);
+        }
+        free(data);
+
+        vkDestroyPipelineCache(device, g_pipeline_cache.cache, NULL);
+        free(g_pipeline_cache.path);
+        g_pipeline_cache = (pipeline_cache_state_t){0};
+}
+
+VkPipelineCache pipeline_cache() { return g_pipeline_cache.cache; }
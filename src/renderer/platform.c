@@ -10,12 +10,21 @@ typedef struct {
         SDL_Window *window;
         uint32_t width;
         uint32_t height;
+
+        // No window and no surface, the swapchain renders into offscreen images instead
+        bool headless;
 } platform_t;
 
 static platform_t g_platform;
 
-void platform_init(uint32_t width, uint32_t height, const char *title) {
-        VK_EXPECT(volkInitialize());
+void platform_init(uint32_t width, uint32_t height, const char *title, bool headless) {
+        g_platform.headless = headless;
+
+        if (headless) {
+                g_platform.width = width;
+                g_platform.height = height;
+                return;
+        }
 
         if (!SDL_Init(SDL_INIT_VIDEO)) {
                 ERROR("Failed to initialize SDL: %s\n", SDL_GetError());
@@ -38,10 +47,25 @@ void platform_init(uint32_t width, uint32_t height, const char *title) {
 }
 
 void platform_shutdown(void) {
+        if (g_platform.headless) {
+                return;
+        }
+
         SDL_DestroyWindow(g_platform.window);
         SDL_Quit();
 }
 
+bool platform_headless() { return g_platform.headless; }
+
+const char *const *platform_instance_extensions(uint32_t *count) {
+        if (g_platform.headless) {
+                *count = 0;
+                return NULL;
+        }
+
+        return SDL_Vulkan_GetInstanceExtensions(count);
+}
+
 VkSurfaceKHR platform_create_surface(VkInstance instance) {
         VkSurfaceKHR surface;
         if (!SDL_Vulkan_CreateSurface(g_platform.window, instance, NULL, &surface)) {
@@ -58,6 +82,10 @@ void platform_get_size(uint32_t *width, uint32_t *height) {
 }
 
 bool platform_size_changed() {
+        if (g_platform.headless) {
+                return false;
+        }
+
         int w, h;
         SDL_GetWindowSize(g_platform.window, &w, &h);
         bool changed = w != g_platform.width || h != g_platform.height;
@@ -68,4 +96,8 @@ bool platform_size_changed() {
         return changed;
 }
 
-void platform_update_window() { SDL_UpdateWindowSurface(g_platform.window); }
+void platform_update_window() {
+        if (!g_platform.headless) {
+                SDL_UpdateWindowSurface(g_platform.window);
+        }
+}
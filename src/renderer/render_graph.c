@@ -1,36 +1,98 @@
 #include "renderer/render_graph.h"
 
+#include "renderer/buffer.h"
+#include "renderer/command.h"
+#include "renderer/deletion_queue.h"
 #include "renderer/image.h"
 #include "renderer/swapchain.h"
 #include "renderer/vk_context.h"
 
+#include "common/array.h"
+#include "common/job.h"
+#include "common/profiler.h"
+
 #include "husky.h"
 
-attachment_handle_t render_graph_add_attachment(render_graph_t *graph, VkExtent3D extent,
-                                                VkFormat format, VkImageAspectFlags flags,
-                                                VkImageUsageFlags usage) {
+#include <stdio.h>
+#include <stdlib.h>
+
+attachment_handle_t render_graph_add_attachment(render_graph_t *graph, float scale,
+                                                VkFormat format, VkImageAspectFlags aspect,
+                                                VkImageUsageFlags usage, uint32_t flags) {
         ASSERT(graph->attachment_count < MAX_ATTACHMENTS);
+        ASSERT(!graph->allocated);
 
         attachment_handle_t attachment_ref = (attachment_handle_t)graph->attachment_count;
         graph->attachment_count++;
 
-        AllocatedImageCreateInfo allocated_image_info = {
-            .extent = extent,
+        graph->attachments[attachment_ref] = (render_attachment_t){
+            .scale = scale,
             .format = format,
-            .memory_props = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-            .memory_usage = VMA_MEMORY_USAGE_GPU_ONLY,
-            .aspect_flags = flags,
-            .usage_flags = usage,
+            .aspect = aspect,
+            .usage = usage,
+            .flags = flags,
         };
 
-        allocated_image_create(&allocated_image_info, &graph->attachments[attachment_ref].image);
-
         return attachment_ref;
 }
 
+// Images and memory blocks taken out of a graph, so a resize can hand them to the deletion queue
+typedef struct attachments_retired {
+        AllocatedImage images[MAX_ATTACHMENTS]; // no allocation if bound to a block
+        uint32_t image_count;
+        VmaAllocation blocks[MAX_ATTACHMENTS];
+        uint32_t block_count;
+} attachments_retired_t;
+
+static attachments_retired_t *attachments_detach(render_graph_t *graph) {
+        attachments_retired_t *retired = calloc(1, sizeof(attachments_retired_t));
+        ASSERT(retired);
+
+        for (uint32_t i = 0; i < graph->attachment_count; i++) {
+                render_attachment_t *attachment = &graph->attachments[i];
+
+                retired->images[retired->image_count++] = attachment->image;
+                if (attachment->block >= 0) {
+                        retired->images[retired->image_count - 1].allocation = VK_NULL_HANDLE;
+                }
+                attachment->image = (AllocatedImage){0};
+        }
+
+        for (uint32_t b = 0; b < graph->memory.block_count; b++) {
+                retired->blocks[retired->block_count++] = graph->blocks[b].allocation;
+        }
+
+        graph->memory = (render_graph_memory_t){0};
+        graph->allocated = false;
+
+        return retired;
+}
+
+static void attachments_retired_destroy(uint64_t handle) {
+        attachments_retired_t *retired = (attachments_retired_t *)(uintptr_t)handle;
+        VkDevice device = vk_context_device();
+
+        for (uint32_t i = 0; i < retired->image_count; i++) {
+                AllocatedImage *image = &retired->images[i];
+
+                if (image->allocation) {
+                        allocated_image_destroy(image, device);
+                } else {
+                        image_destroy(&image->image, device);
+                        vkDestroyImage(device, image->image.image, NULL);
+                }
+        }
+
+        for (uint32_t b = 0; b < retired->block_count; b++) {
+                vmaFreeMemory(vk_memory_allocator(), retired->blocks[b]);
+        }
+
+        free(retired);
+}
+
 void render_graph_destroy(render_graph_t *graph) {
-        for (int i = 0; i < graph->attachment_count; i++) {
-                allocated_image_destroy(&graph->attachments[i].image, vk_context_device());
+        if (graph->allocated) {
+                attachments_retired_destroy((uintptr_t)attachments_detach(graph));
         }
 
         for (int i = 0; i < graph->pass_count; i++) {
@@ -39,6 +101,11 @@ void render_graph_destroy(render_graph_t *graph) {
                 if (pass->cleanup)
                         pass->cleanup();
         }
+
+        if (graph->recording.jobs) {
+                array_free(graph->recording.jobs);
+                array_free(graph->recording.commands);
+        }
 }
 
 VkFormat render_graph_attachment_format(render_graph_t *graph, attachment_handle_t attachment_ref) {
@@ -48,7 +115,7 @@ VkFormat render_graph_attachment_format(render_graph_t *graph, attachment_handle
 
         ASSERT(attachment_ref < graph->attachment_count);
 
-        return graph->attachments[attachment_ref].image.image.format;
+        return graph->attachments[attachment_ref].format;
 }
 
 Image *render_graph_attachment_image(render_graph_t *graph, attachment_handle_t attachment_ref) {
@@ -57,27 +124,464 @@ Image *render_graph_attachment_image(render_graph_t *graph, attachment_handle_t
         }
 
         ASSERT(attachment_ref < graph->attachment_count);
+        ASSERT(graph->allocated);
 
         return &graph->attachments[attachment_ref].image.image;
 }
 
+_Static_assert(MAX_PASSES <= GPU_TIMER_MAX_SCOPES, "every pass needs a gpu_timer scope");
+
 void render_graph_register_pass(render_graph_t *graph, render_pass_t pass) {
         ASSERT(graph->pass_count < MAX_PASSES);
+        ASSERT(!graph->allocated);
 
         graph->render_passes[graph->pass_count] = pass;
         graph->pass_count++;
+        graph->plan.compiled = false;
 }
 
-static void begin_rendering(VkCommandBuffer cmd, VkRenderingAttachmentInfo *colors,
-                            uint32_t color_count, VkRenderingAttachmentInfo *depth, uint32_t width,
-                            uint32_t height) {
-        VkRect2D scissor = {
-            {0, 0},
-            {.width = width, .height = height},
+static void attachment_scope(VkImageLayout layout, VkPipelineStageFlags2 *stages,
+                             VkAccessFlags2 *access) {
+        if (layout == VK_IMAGE_LAYOUT_GENERAL) {
+                *stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+                *access =
+                    VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+                return;
+        }
+
+        image_layout_scope(layout, stages, access);
+}
+
+static uint32_t attachment_slot(attachment_handle_t attachment) {
+        return attachment == ATTACHMENT_BACKBUFFER ? MAX_ATTACHMENTS : attachment;
+}
+
+static void attachment_lifetimes(render_graph_t *graph) {
+        for (uint32_t i = 0; i < graph->attachment_count; i += 1) {
+                graph->attachments[i].first_pass = UINT32_MAX;
+                graph->attachments[i].last_pass = 0;
+        }
+
+        for (uint32_t p = 0; p < graph->pass_count; p += 1) {
+                render_pass_t *pass = &graph->render_passes[p];
+                for (uint32_t a = 0; a < pass->attachment_count; a += 1) {
+                        if (pass->attachments[a] == ATTACHMENT_BACKBUFFER) {
+                                continue;
+                        }
+
+                        render_attachment_t *attachment = &graph->attachments[pass->attachments[a]];
+                        if (p < attachment->first_pass) {
+                                attachment->first_pass = p;
+                        }
+                        attachment->last_pass = p;
+                }
+        }
+}
+
+static bool lifetimes_overlap(const render_attachment_t *a, const render_attachment_t *b) {
+        return a->first_pass <= b->last_pass && b->first_pass <= a->last_pass;
+}
+
+static bool has_lazy_memory() {
+        const VkPhysicalDeviceMemoryProperties *properties;
+        vmaGetMemoryProperties(vk_memory_allocator(), &properties);
+
+        for (uint32_t i = 0; i < properties->memoryTypeCount; i += 1) {
+                if (properties->memoryTypes[i].propertyFlags &
+                    VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) {
+                        return true;
+                }
+        }
+
+        return false;
+}
+
+static void attachment_allocate_dedicated(render_graph_t *graph, render_attachment_t *attachment) {
+        bool lazy = attachment->lazy;
+        AllocatedImageCreateInfo create_info = {
+            .extent = attachment->extent,
+            .format = attachment->format,
+            .memory_props = lazy ? 0 : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            .memory_usage =
+                lazy ? VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED : VMA_MEMORY_USAGE_GPU_ONLY,
+            .aspect_flags = attachment->aspect,
+            .usage_flags = attachment->usage | (lazy ? VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT : 0),
+        };
+        allocated_image_create(&create_info, &attachment->image);
+
+        VmaAllocationInfo allocation_info;
+        vmaGetAllocationInfo(vk_memory_allocator(), attachment->image.allocation, &allocation_info);
+        attachment->size = allocation_info.size;
+
+        graph->memory.requested += attachment->size;
+        if (attachment->lazy) {
+                graph->memory.lazy_count += 1;
+        } else {
+                graph->memory.allocated += attachment->size;
+        }
+}
+
+// Creates the image without memory, it is bound once its block is allocated
+static VkImage attachment_image_create(render_attachment_t *attachment,
+                                       VkMemoryRequirements *requirements) {
+        VkImageCreateInfo create_info = {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+            .imageType = VK_IMAGE_TYPE_2D,
+            .format = attachment->format,
+            .extent = attachment->extent,
+            .mipLevels = 1,
+            .arrayLayers = 1,
+            .samples = VK_SAMPLE_COUNT_1_BIT,
+            .tiling = VK_IMAGE_TILING_OPTIMAL,
+            .usage = attachment->usage,
         };
+
+        VkImage image;
+        VK_EXPECT(vkCreateImage(vk_context_device(), &create_info, NULL, &image));
+        vkGetImageMemoryRequirements(vk_context_device(), image, requirements);
+
+        return image;
+}
+
+// Places transients in blocks so that attachments sharing a block are never used by the same
+// pass. Largest first, so smaller attachments fill in around them.
+static void attachments_place(render_graph_t *graph, uint32_t *order, uint32_t count,
+                              VkMemoryRequirements *requirements, VkDeviceSize *alignments) {
+        for (uint32_t k = 0; k < count; k += 1) {
+                uint32_t i = order[k];
+                render_attachment_t *attachment = &graph->attachments[i];
+
+                int32_t block = -1;
+                for (uint32_t b = 0; b < graph->memory.block_count && block < 0; b += 1) {
+                        if (!(graph->blocks[b].memory_types & requirements[i].memoryTypeBits)) {
+                                continue;
+                        }
+
+                        bool overlaps = false;
+                        for (uint32_t j = 0; j < graph->attachment_count && !overlaps; j += 1) {
+                                overlaps = graph->attachments[j].block == (int32_t)b &&
+                                           lifetimes_overlap(&graph->attachments[j], attachment);
+                        }
+                        block = overlaps ? -1 : (int32_t)b;
+                }
+
+                if (block < 0) {
+                        block = graph->memory.block_count++;
+                        graph->blocks[block] = (render_memory_block_t){.memory_types = ~0u};
+                        alignments[block] = 1;
+                }
+
+                render_memory_block_t *memory = &graph->blocks[block];
+                memory->memory_types &= requirements[i].memoryTypeBits;
+                if (requirements[i].size > memory->size) {
+                        memory->size = requirements[i].size;
+                }
+                if (requirements[i].alignment > alignments[block]) {
+                        alignments[block] = requirements[i].alignment;
+                }
+                attachment->block = block;
+        }
+}
+
+static uint32_t scaled_size(uint32_t size, float scale) {
+        uint32_t scaled = (uint32_t)(size * scale + 0.5f);
+        return scaled ? scaled : 1;
+}
+
+static void attachments_allocate(render_graph_t *graph) {
+        attachment_lifetimes(graph);
+        bool lazy_memory = has_lazy_memory();
+
+        VkImage images[MAX_ATTACHMENTS] = {0};
+        VkMemoryRequirements requirements[MAX_ATTACHMENTS];
+        uint32_t order[MAX_ATTACHMENTS];
+        uint32_t transient_count = 0;
+
+        for (uint32_t i = 0; i < graph->attachment_count; i += 1) {
+                render_attachment_t *attachment = &graph->attachments[i];
+                attachment->block = -1;
+                attachment->extent = (VkExtent3D){
+                    .width = scaled_size(graph->extent.width, attachment->scale),
+                    .height = scaled_size(graph->extent.height, attachment->scale),
+                    .depth = 1,
+                };
+
+                bool used = attachment->first_pass <= attachment->last_pass;
+                bool transient = used && (attachment->flags & RENDER_ATTACHMENT_TRANSIENT);
+
+                // Depth written and tested within a single pass never has to leave tile memory
+                attachment->lazy = transient && lazy_memory &&
+                                   attachment->first_pass == attachment->last_pass &&
+                                   attachment->usage == VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+
+                if (!transient || attachment->lazy) {
+                        attachment_allocate_dedicated(graph, attachment);
+                        continue;
+                }
+
+                images[i] = attachment_image_create(attachment, &requirements[i]);
+                attachment->size = requirements[i].size;
+                graph->memory.requested += attachment->size;
+
+                uint32_t k = transient_count++;
+                for (; k > 0 && requirements[order[k - 1]].size < attachment->size; k -= 1) {
+                        order[k] = order[k - 1];
+                }
+                order[k] = i;
+        }
+
+        VkDeviceSize alignments[MAX_ATTACHMENTS];
+        attachments_place(graph, order, transient_count, requirements, alignments);
+
+        for (uint32_t b = 0; b < graph->memory.block_count; b += 1) {
+                render_memory_block_t *block = &graph->blocks[b];
+
+                VkMemoryRequirements block_requirements = {
+                    .size = block->size,
+                    .alignment = alignments[b],
+                    .memoryTypeBits = block->memory_types,
+                };
+                VmaAllocationCreateInfo create_info = {
+                    .usage = VMA_MEMORY_USAGE_GPU_ONLY,
+                    .requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                };
+                VK_EXPECT(vmaAllocateMemory(vk_memory_allocator(), &block_requirements,
+                                            &create_info, &block->allocation, NULL));
+                graph->memory.allocated += block->size;
+        }
+
+        for (uint32_t k = 0; k < transient_count; k += 1) {
+                render_attachment_t *attachment = &graph->attachments[order[k]];
+                VkImage image = images[order[k]];
+
+                VK_EXPECT(vmaBindImageMemory(vk_memory_allocator(),
+                                             graph->blocks[attachment->block].allocation, image));
+
+                ImageCreateInfo view_info = {
+                    .image = image,
+                    .extent = attachment->extent,
+                    .format = attachment->format,
+                    .layout = VK_IMAGE_LAYOUT_UNDEFINED,
+                    .aspect_flags = attachment->aspect,
+                    .device = vk_context_device(),
+                };
+                image_create(&view_info, &attachment->image.image);
+        }
+
+        graph->allocated = true;
+
+        render_graph_memory_t *memory = &graph->memory;
+        INFO("render graph: %ux%u, %u attachments, %.1f MiB requested, %.1f MiB allocated "
+             "(%u aliased blocks, %u lazily allocated), %.1f MiB saved",
+             graph->extent.width, graph->extent.height, graph->attachment_count,
+             memory->requested / 1048576.0,
+             memory->allocated / 1048576.0, memory->block_count, memory->lazy_count,
+             (memory->requested - memory->allocated) / 1048576.0);
+}
+
+// The attachment that last used the memory of a transient before its first use in a frame. For
+// an attachment alone in its block that is itself, in the previous frame.
+static uint32_t attachment_predecessor(render_graph_t *graph, uint32_t index) {
+        render_attachment_t *attachment = &graph->attachments[index];
+
+        uint32_t before = index, latest = index;
+        for (uint32_t j = 0; j < graph->attachment_count; j += 1) {
+                render_attachment_t *other = &graph->attachments[j];
+                if (other->block != attachment->block) {
+                        continue;
+                }
+
+                if (other->first_pass < attachment->first_pass &&
+                    (before == index ||
+                     other->first_pass > graph->attachments[before].first_pass)) {
+                        before = j;
+                }
+                if (other->first_pass > graph->attachments[latest].first_pass) {
+                        latest = j;
+                }
+        }
+
+        return before != index ? before : latest;
+}
+
+render_graph_memory_t render_graph_memory(render_graph_t *graph) { return graph->memory; }
+
+static bool extent_empty(VkExtent2D extent) { return !extent.width || !extent.height; }
+
+void render_graph_resize(render_graph_t *graph, VkExtent2D extent) {
+        // A minimized window, keep the attachments until there is something to render again
+        if (extent_empty(extent)) {
+                return;
+        }
+
+        graph->extent = extent;
+        if (!graph->allocated) {
+                return;
+        }
+
+        // Frames in flight may still be using the attachments
+        deletion_queue_retire(attachments_retired_destroy, (uintptr_t)attachments_detach(graph));
+
+        graph->plan.compiled = false;
+        render_graph_compile(graph);
+}
+
+VkExtent2D render_graph_extent(render_graph_t *graph) { return graph->extent; }
+
+void render_graph_set_render_scale(render_graph_t *graph, float scale) {
+        ASSERT(scale > 0.0f && scale <= 1.0f);
+        graph->render_scale = scale;
+}
+
+VkExtent2D render_graph_render_extent(render_graph_t *graph, attachment_handle_t attachment_ref) {
+        Image *image = render_graph_attachment_image(graph, attachment_ref);
+        if (attachment_ref == ATTACHMENT_BACKBUFFER || !graph->render_scale) {
+                return (VkExtent2D){image->extent.width, image->extent.height};
+        }
+
+        return (VkExtent2D){
+            .width = scaled_size(image->extent.width, graph->render_scale),
+            .height = scaled_size(image->extent.height, graph->render_scale),
+        };
+}
+
+void render_graph_compile(render_graph_t *graph) {
+        if (extent_empty(graph->extent)) {
+                return;
+        }
+
+        if (!graph->allocated) {
+                attachments_allocate(graph);
+
+                for (uint32_t p = 0; p < graph->pass_count; p += 1) {
+                        if (graph->render_passes[p].setup) {
+                                graph->render_passes[p].setup();
+                        }
+                }
+        }
+
+        render_graph_plan_t *plan = &graph->plan;
+        *plan = (render_graph_plan_t){.compiled = true};
+
+        // Last use of every attachment, one extra slot for the backbuffer
+        VkImageLayout layouts[MAX_ATTACHMENTS + 1] = {0};
+        bool used[MAX_ATTACHMENTS + 1] = {0};
+        for (uint32_t p = 0; p < graph->pass_count; p += 1) {
+                render_pass_t *pass = &graph->render_passes[p];
+                for (uint32_t a = 0; a < pass->attachment_count; a += 1) {
+                        uint32_t slot = attachment_slot(pass->attachments[a]);
+                        layouts[slot] = pass->attachment_states[a];
+                }
+        }
+
+        uint32_t barrier_total = 0;
+        uint32_t skipped = 0;
+        for (uint32_t p = 0; p < graph->pass_count; p += 1) {
+                render_pass_t *pass = &graph->render_passes[p];
+
+                for (uint32_t a = 0; a < pass->attachment_count; a += 1) {
+                        attachment_handle_t attachment = pass->attachments[a];
+                        uint32_t slot = attachment_slot(attachment);
+                        VkImageLayout layout = pass->attachment_states[a];
+
+                        render_barrier_t barrier = {
+                            .attachment = attachment,
+                            .layout = layout,
+                        };
+                        attachment_scope(layout, &barrier.dst_stages, &barrier.dst_access);
+
+                        VkAccessFlags2 src_access;
+                        attachment_scope(layouts[slot], &barrier.src_stages, &src_access);
+                        barrier.src_access = src_access & IMAGE_WRITE_ACCESS;
+
+                        bool first_use = !used[slot];
+                        bool depth = layout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL;
+                        bool transient = attachment != ATTACHMENT_BACKBUFFER &&
+                                         graph->attachments[attachment].block >= 0;
+                        used[slot] = true;
+
+                        if (depth) {
+                                plan->store_depth[p] =
+                                    !(graph->attachments[attachment].flags &
+                                      RENDER_ATTACHMENT_TRANSIENT) ||
+                                    graph->attachments[attachment].last_pass != p;
+                        }
+
+                        if (first_use && attachment == ATTACHMENT_BACKBUFFER) {
+                                // A freshly acquired image, chain onto the semaphore wait instead
+                                barrier.src_stages = SWAPCHAIN_ACQUIRE_STAGE;
+                                barrier.src_access = VK_ACCESS_2_NONE;
+                                barrier.discard = true;
+                        } else if (first_use && transient) {
+                                // Wait for whichever attachment used the memory last
+                                uint32_t previous = attachment_predecessor(graph, attachment);
+                                attachment_scope(layouts[previous], &barrier.src_stages,
+                                                 &src_access);
+                                barrier.src_access = src_access & IMAGE_WRITE_ACCESS;
+                                barrier.discard = true;
+                                plan->clear_depth[p] = depth;
+                        } else if (first_use && depth) {
+                                barrier.discard = true;
+                                plan->clear_depth[p] = true;
+                        } else if (!first_use && layouts[slot] == layout && !barrier.src_access &&
+                                   !(barrier.dst_access & IMAGE_WRITE_ACCESS)) {
+                                // Read after read in the same layout
+                                skipped += 1;
+                                continue;
+                        }
+
+                        layouts[slot] = layout;
+                        plan->barriers[p][plan->barrier_counts[p]++] = barrier;
+                        barrier_total += 1;
+                }
+        }
+
+        DEBUG("render graph: %u passes, %u barriers, %u skipped", graph->pass_count, barrier_total,
+              skipped);
+}
+
+// Attachment formats and area of a pass, shared by the rendering instance in the frame's command
+// buffer and the secondary buffers continuing it
+typedef struct pass_target {
+        VkFormat color_formats[8];
+        uint32_t color_count;
+        VkFormat depth_format; // VK_FORMAT_UNDEFINED without depth
+        VkExtent2D extent;
+} pass_target_t;
+
+static pass_target_t pass_target(render_graph_t *graph, uint32_t pass_index) {
+        render_pass_t *pass = &graph->render_passes[pass_index];
+        pass_target_t target = {.depth_format = VK_FORMAT_UNDEFINED};
+
+        for (uint32_t a = 0; a < pass->attachment_count; a += 1) {
+                attachment_handle_t attachment = pass->attachments[a];
+                VkImageLayout layout = pass->attachment_states[a];
+
+                if (layout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL) {
+                        target.color_formats[target.color_count++] =
+                            render_graph_attachment_format(graph, attachment);
+                }
+                if (layout == VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL) {
+                        target.depth_format = render_graph_attachment_format(graph, attachment);
+                }
+
+                target.extent = render_graph_render_extent(graph, attachment);
+        }
+
+        return target;
+}
+
+static bool pass_target_renders(pass_target_t *target) {
+        return target->color_count > 0 || target->depth_format != VK_FORMAT_UNDEFINED;
+}
+
+static void begin_rendering(VkCommandBuffer cmd, VkRenderingAttachmentInfo *colors,
+                            uint32_t color_count, VkRenderingAttachmentInfo *depth,
+                            VkExtent2D extent) {
         VkRenderingInfo render_info = {
             .sType = VK_STRUCTURE_TYPE_RENDERING_INFO,
-            .renderArea = scissor,
+            .flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT,
+            .renderArea = {{0, 0}, extent},
             .colorAttachmentCount = color_count,
             .pColorAttachments = colors,
             .pDepthAttachment = depth,
@@ -85,15 +589,20 @@ static void begin_rendering(VkCommandBuffer cmd, VkRenderingAttachmentInfo *colo
         };
 
         vkCmdBeginRendering(cmd, &render_info);
+}
 
+// Dynamic state isn't inherited, every secondary buffer sets its own
+static void set_viewport(VkCommandBuffer cmd, VkExtent2D extent) {
         VkViewport viewport = {
             .x = 0,
             .y = 0,
-            .width = width,
-            .height = height,
+            .width = extent.width,
+            .height = extent.height,
             .minDepth = 0.0f,
             .maxDepth = 1.0f,
         };
+        VkRect2D scissor = {{0, 0}, extent};
+
         vkCmdSetViewport(cmd, 0, 1, &viewport);
         vkCmdSetScissor(cmd, 0, 1, &scissor);
 }
@@ -106,33 +615,231 @@ VkRenderingAttachmentInfo color_attachment(Image *image) {
         };
 }
 
-static VkRenderingAttachmentInfo depth_attachment(Image *image) {
+static VkImageAspectFlags format_aspect(VkFormat format) {
+        switch (format) {
+        case VK_FORMAT_D16_UNORM:
+        case VK_FORMAT_D32_SFLOAT:
+        case VK_FORMAT_X8_D24_UNORM_PACK32:
+                return VK_IMAGE_ASPECT_DEPTH_BIT;
+        case VK_FORMAT_D16_UNORM_S8_UINT:
+        case VK_FORMAT_D24_UNORM_S8_UINT:
+        case VK_FORMAT_D32_SFLOAT_S8_UINT:
+                return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+        default:
+                return VK_IMAGE_ASPECT_COLOR_BIT;
+        }
+}
+
+// All of a pass's barriers go into one dependency
+static void record_barriers(render_graph_t *graph, uint32_t pass, VkCommandBuffer cmd) {
+        uint32_t count = graph->plan.barrier_counts[pass];
+        if (count == 0) {
+                return;
+        }
+
+        VkImageMemoryBarrier2 barriers[8];
+        for (uint32_t b = 0; b < count; b += 1) {
+                render_barrier_t *barrier = &graph->plan.barriers[pass][b];
+                Image *image = render_graph_attachment_image(graph, barrier->attachment);
+
+                barriers[b] = (VkImageMemoryBarrier2){
+                    .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+                    .srcStageMask = barrier->src_stages,
+                    .srcAccessMask = barrier->src_access,
+                    .dstStageMask = barrier->dst_stages,
+                    .dstAccessMask = barrier->dst_access,
+                    .oldLayout = barrier->discard ? VK_IMAGE_LAYOUT_UNDEFINED : image->layout,
+                    .newLayout = barrier->layout,
+                    .image = image->image,
+                    .subresourceRange =
+                        {
+                            .aspectMask = format_aspect(image->format),
+                            .levelCount = VK_REMAINING_MIP_LEVELS,
+                            .layerCount = VK_REMAINING_ARRAY_LAYERS,
+                        },
+                };
+
+                image->layout = barrier->layout;
+        }
+
+        VkDependencyInfo dependency = {
+            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+            .imageMemoryBarrierCount = count,
+            .pImageMemoryBarriers = barriers,
+        };
+        vkCmdPipelineBarrier2(cmd, &dependency);
+}
+
+static VkRenderingAttachmentInfo depth_attachment(Image *image, bool clear, bool store) {
         return (VkRenderingAttachmentInfo){
             .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO,
             .imageView = image->image_view,
             .imageLayout = image->layout,
-            .loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR,
-            .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+            .loadOp = clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD,
+            .storeOp = store ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE,
             .clearValue.depthStencil.depth = 1.0f,
         };
 }
 
+static void timing_log(render_graph_t *graph) {
+        render_graph_timing_t *timing = &graph->timing;
+
+        char line[512];
+        int length = 0;
+        double total = 0.0;
+
+        for (uint32_t p = 0; p < graph->pass_count && length < sizeof(line); p += 1) {
+                double average = timing->sums[p] / timing->sample_count;
+                total += average;
+
+                const char *name = graph->render_passes[p].name;
+                length += snprintf(line + length, sizeof(line) - length, " %s %.3f",
+                                   name ? name : "unnamed", average);
+        }
+
+        DEBUG("gpu passes (ms, %u frame average): total %.3f,%s", timing->sample_count, total,
+              line);
+}
+
+// Reads the timestamps this frame slot wrote last time around and adds them to the averages
+static void timing_collect(render_graph_t *graph, uint32_t frame) {
+        render_graph_timing_t *timing = &graph->timing;
+
+        double pass_ms[GPU_TIMER_MAX_SCOPES];
+        uint32_t count = gpu_timer_read_scopes(frame, pass_ms);
+        if (count != graph->pass_count) {
+                return;
+        }
+
+        uint32_t slot = timing->next_sample;
+        bool full = timing->sample_count == RENDER_GRAPH_TIMING_WINDOW;
+        for (uint32_t p = 0; p < count; p += 1) {
+                if (full) {
+                        timing->sums[p] -= timing->samples[p][slot];
+                }
+                timing->samples[p][slot] = pass_ms[p];
+                timing->sums[p] += pass_ms[p];
+        }
+
+        timing->next_sample = (slot + 1) % RENDER_GRAPH_TIMING_WINDOW;
+        timing->sample_count += !full;
+
+        if (timing->log_interval && ++timing->frames_since_log >= timing->log_interval) {
+                timing->frames_since_log = 0;
+                timing_log(graph);
+        }
+}
+
+uint32_t render_graph_pass_timings(render_graph_t *graph, render_pass_timing_t *timings) {
+        render_graph_timing_t *timing = &graph->timing;
+
+        for (uint32_t p = 0; p < graph->pass_count; p += 1) {
+                timings[p] = (render_pass_timing_t){
+                    .name = graph->render_passes[p].name,
+                    .average_ms = timing->sample_count ? timing->sums[p] / timing->sample_count
+                                                       : 0.0,
+                };
+        }
+
+        return graph->pass_count;
+}
+
+void render_graph_set_timing_log(render_graph_t *graph, uint32_t frames) {
+        graph->timing.log_interval = frames;
+        graph->timing.frames_since_log = 0;
+}
+
+static void record_job(void *data, uint32_t index, uint32_t worker) {
+        PROFILE_ZONE("render_pass_record");
+
+        render_graph_t *graph = data;
+        render_graph_recording_t *recording = &graph->recording;
+        render_job_t *job = &recording->jobs[index];
+
+        pass_target_t target = pass_target(graph, job->pass);
+        bool rendering = pass_target_renders(&target);
+
+        VkCommandBufferInheritanceRenderingInfo inheritance = {
+            .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO,
+            .colorAttachmentCount = target.color_count,
+            .pColorAttachmentFormats = target.color_formats,
+            .depthAttachmentFormat = target.depth_format,
+            .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
+        };
+        VkCommandBuffer cmd =
+            secondary_command_begin(recording->frame, worker, rendering ? &inheritance : NULL);
+
+        if (rendering) {
+                set_viewport(cmd, target.extent);
+        }
+        graph->render_passes[job->pass].record(cmd, job->chunk, job->chunk_count);
+
+        VK_EXPECT(vkEndCommandBuffer(cmd));
+        recording->commands[index] = cmd;
+}
+
+// Records every pass into secondary command buffers in parallel
+static void record_passes(render_graph_t *graph, uint32_t frame) {
+        render_graph_recording_t *recording = &graph->recording;
+        if (!recording->jobs) {
+                recording->jobs = array(render_job_t);
+                recording->commands = array(VkCommandBuffer);
+        }
+        array_header(recording->jobs)->length = 0;
+        array_header(recording->commands)->length = 0;
+        recording->frame = frame;
+
+        for (uint32_t p = 0; p < graph->pass_count; p += 1) {
+                render_pass_t *pass = &graph->render_passes[p];
+                uint32_t chunk_count = pass->chunk_count ? pass->chunk_count() : 1;
+                ASSERT(chunk_count > 0);
+
+                recording->first_job[p] = array_length(recording->jobs);
+                for (uint32_t c = 0; c < chunk_count; c += 1) {
+                        render_job_t job = {.pass = p, .chunk = c, .chunk_count = chunk_count};
+                        array_append(recording->jobs, job);
+                        array_append(recording->commands, VK_NULL_HANDLE);
+                }
+        }
+        recording->first_job[graph->pass_count] = array_length(recording->jobs);
+
+        // The frame's previous submission has finished, so its buffers are no longer in use
+        secondary_commands_reset(frame);
+        jobs_parallel_for(array_length(recording->jobs), record_job, graph);
+}
+
 void render_graph_execute(render_graph_t *graph, VkCommandBuffer cmd) {
+        PROFILE_ZONE("render_graph_execute");
+
+        if (!graph->plan.compiled) {
+                render_graph_compile(graph);
+        }
+        // Nothing to render into until the graph has a size
+        if (!graph->plan.compiled) {
+                return;
+        }
+
+        uint32_t frame = swapchain_current_frame_index();
+        timing_collect(graph, frame);
+
+        record_passes(graph, frame);
+
         for (int i = 0; i < graph->pass_count; i++) {
                 render_pass_t *pass = &graph->render_passes[i];
 
+                // Layout transitions count towards the pass that needs them
+                gpu_timer_scope_begin(cmd, frame, i);
+                record_barriers(graph, i, cmd);
+
                 VkRenderingAttachmentInfo color_attachments[8];
                 uint32_t color_attachments_count = 0;
 
                 VkRenderingAttachmentInfo depth;
                 bool has_depth = false;
 
-                uint32_t width = 0, height = 0;
-
                 for (int a = 0; a < pass->attachment_count; a++) {
                         attachment_handle_t attachment_ref = pass->attachments[a];
                         Image *attachment = render_graph_attachment_image(graph, attachment_ref);
-                        image_transition(attachment, cmd, pass->attachment_states[a]);
 
                         if (pass->attachment_states[a] ==
                             VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL) {
@@ -142,24 +849,28 @@ void render_graph_execute(render_graph_t *graph, VkCommandBuffer cmd) {
                         }
                         if (pass->attachment_states[a] ==
                             VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL) {
-                                depth = depth_attachment(attachment);
+                                // Depth is cleared by the first pass that renders into it, later
+                                // passes test against it
+                                depth = depth_attachment(attachment, graph->plan.clear_depth[i],
+                                                         graph->plan.store_depth[i]);
                                 has_depth = true;
                         }
-
-                        width = attachment->extent.width;
-                        height = attachment->extent.height;
                 }
 
                 if (color_attachments_count > 0 || has_depth) {
                         VkRenderingAttachmentInfo *depth_ref = has_depth ? &depth : VK_NULL_HANDLE;
                         begin_rendering(cmd, color_attachments, color_attachments_count, depth_ref,
-                                        width, height);
+                                        pass_target(graph, i).extent);
                 }
 
-                graph->render_passes[i].record(cmd);
+                uint32_t first = graph->recording.first_job[i];
+                vkCmdExecuteCommands(cmd, graph->recording.first_job[i + 1] - first,
+                                     &graph->recording.commands[first]);
 
                 if (color_attachments_count > 0 || has_depth) {
                         vkCmdEndRendering(cmd);
                 }
+
+                gpu_timer_scope_end(cmd, frame, i);
         }
 }
@@ -1,51 +1,110 @@
 #include "renderer/renderer.h"
 
+#include "renderer/bindless.h"
 #include "renderer/buffer.h"
 #include "renderer/command.h"
+#include "renderer/deletion_queue.h"
 #include "renderer/descriptors.h"
 #include "renderer/draw.h"
+#include "renderer/frame_pacing.h"
 #include "renderer/gpu_model.h"
+#include "renderer/gpu_timer.h"
 #include "renderer/image.h"
+#include "renderer/lights.h"
+#include "renderer/material.h"
+#include "renderer/pipeline.h"
+#include "renderer/pipeline_cache.h"
 #include "renderer/platform.h"
 #include "renderer/render_graph.h"
 #include "renderer/render_passes.h"
+#include "renderer/resolution.h"
 #include "renderer/sampler.h"
 #include "renderer/swapchain.h"
+#include "renderer/terrain.h"
+#include "renderer/timeline.h"
+#include "renderer/visibility.h"
 #include "renderer/vk_context.h"
 
+#include "common/profiler.h"
+
 #include "husky.h"
 
+#define PIPELINE_CACHE_PATH "pipeline_cache.bin"
+// How long a frame without a window area sleeps instead of rendering
+#define MINIMIZED_DELAY_MS 16
+
 static render_graph_t g_render_graph;
+// The window has no area, e.g. when minimized, so the frame isn't rendered at all
+static bool g_frame_skipped;
+static double g_gpu_frame_time = -1.0;
+static resolution_controller_t g_resolution;
+
+static const VkPresentModeKHR g_present_modes[] = {
+    [PRESENT_MODE_FIFO] = VK_PRESENT_MODE_FIFO_KHR,
+    [PRESENT_MODE_FIFO_RELAXED] = VK_PRESENT_MODE_FIFO_RELAXED_KHR,
+    [PRESENT_MODE_MAILBOX] = VK_PRESENT_MODE_MAILBOX_KHR,
+    [PRESENT_MODE_IMMEDIATE] = VK_PRESENT_MODE_IMMEDIATE_KHR,
+};
 
 bool renderer_init(renderer_config_t *c) {
-        platform_init(c->width, c->height, c->title);
-        vk_context_init();
+        platform_init(c->width, c->height, c->title, c->headless);
+        vk_context_init(c->debug);
+        timeline_init();
+        deletion_queue_init();
+        pipeline_cache_init(PIPELINE_CACHE_PATH);
 
         vk_memory_allocator_init();
 
-        descriptors_init();
+        uint32_t frames_in_flight = c->frames_in_flight ? c->frames_in_flight : NUM_FRAMES;
+        descriptors_init(frames_in_flight);
+        bindless_init();
         samplers_init();
 
-        swapchain_create();
+        swapchain_create(frames_in_flight, g_present_modes[c->present_mode]);
+        material_table_init();
+        lights_init();
+        frame_pacing_init(c->low_latency);
+        gpu_timer_init();
 
         immediate_command_init();
+        secondary_commands_init();
+
+        visibility_gpu_init();
+
+        render_graph_resize(&g_render_graph, swapchain_extent());
+        if (c->target_gpu_ms > 0.0f) {
+                g_resolution =
+                    resolution_controller_create(c->target_gpu_ms, c->min_render_scale, 1.0f);
+        }
 
+        // Both are transient so their contents aren't kept between frames, but the terrain and
+        // pbr passes use them together, so they can't alias each other's memory
         attachment_handle_t hdr = render_graph_add_attachment(
-            &g_render_graph, (VkExtent3D){c->width, c->height, 1}, VK_FORMAT_R16G16B16A16_SFLOAT,
-            VK_IMAGE_ASPECT_COLOR_BIT,
+            &g_render_graph, 1.0f, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT,
             VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
-                VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_STORAGE_BIT);
+                VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_STORAGE_BIT,
+            RENDER_ATTACHMENT_TRANSIENT);
 
         attachment_handle_t depth = render_graph_add_attachment(
-            &g_render_graph, (VkExtent3D){c->width, c->height, 1}, VK_FORMAT_D32_SFLOAT,
-            VK_IMAGE_ASPECT_DEPTH_BIT, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
+            &g_render_graph, 1.0f, VK_FORMAT_D32_SFLOAT, VK_IMAGE_ASPECT_DEPTH_BIT,
+            VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, RENDER_ATTACHMENT_TRANSIENT);
 
         gradient_pass_register(&g_render_graph, hdr);
+        light_cull_pass_register(&g_render_graph);
+        terrain_pass_register(&g_render_graph, hdr, depth);
         pbr_pass_register(&g_render_graph, hdr, depth);
         present_pass_register(&g_render_graph, hdr);
 
+        // Passes only queue their pipelines while registering, compile them all at once
+        pipelines_build();
+        render_graph_compile(&g_render_graph);
+
         draw_buffers_init();
 
+        if (c->debug) {
+                render_graph_set_timing_log(&g_render_graph, 600);
+        }
+
         return true;
 }
 
@@ -53,50 +112,127 @@ void renderer_shutdown() {
         // Make sure the GPU has finished all work
         vk_context_wait_idle();
 
+        terrain_shutdown();
+        visibility_gpu_shutdown();
         gpu_unload_models();
+        deletion_queue_shutdown();
+        material_table_shutdown();
+        lights_shutdown();
         draw_buffers_shutdown();
 
         swapchain_destroy();
+        gpu_timer_shutdown();
+        secondary_commands_shutdown();
         immediate_command_shutdown();
 
         samplers_shutdown();
+        bindless_shutdown();
         descriptors_shutdown();
 
         render_graph_destroy(&g_render_graph);
 
         vk_memory_allocator_shutdown();
 
+        pipeline_cache_shutdown();
+        timeline_shutdown();
         vk_context_shutdown();
         platform_shutdown();
 }
 
 void renderer_draw() {
+        if (g_frame_skipped) {
+                return;
+        }
+
         draw_batches_upload();
+        lights_upload();
+
+        terrain_upload();
+        terrain_cull();
 
         render_graph_execute(&g_render_graph, swapchain_current_frame_command_buffer());
 }
 
 void renderer_end_frame() {
-        image_transition(swapchain_current_image(), swapchain_current_frame_command_buffer(),
-                         VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+        if (g_frame_skipped) {
+                SDL_Delay(MINIMIZED_DELAY_MS);
+                PROFILE_FRAME_END();
+                return;
+        }
+
+        VkCommandBuffer cmd = swapchain_current_frame_command_buffer();
 
-        vkEndCommandBuffer(swapchain_current_frame_command_buffer());
+        if (!platform_headless()) {
+                image_transition(swapchain_current_image(), cmd, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+        }
+
+        gpu_timer_end(cmd, swapchain_current_frame_index());
+        vkEndCommandBuffer(cmd);
 
+        frame_pacing_submit(g_gpu_frame_time);
         swapchain_current_frame_submit();
+        deletion_queue_seal(timeline_submitted());
 
         platform_update_window();
+
+        PROFILE_FRAME_END();
 }
 
 void renderer_begin_frame() {
-        if (platform_size_changed()) {
+        PROFILE_FRAME_BEGIN();
+
+        draw_buffers_clear();
+        lights_clear();
+
+        bool resized = platform_size_changed();
+        uint32_t width, height;
+        platform_get_size(&width, &height);
+
+        // Neither the swapchain nor the attachments can be zero sized, wait until the window
+        // has an area again
+        g_frame_skipped = !width || !height;
+        if (g_frame_skipped) {
+                return;
+        }
+
+        if (resized) {
                 SwapchainRecreate();
         }
 
-        if (!swapchain_next_frame()) {
+        while (!swapchain_next_frame()) {
                 SwapchainRecreate();
         }
 
+        deletion_queue_collect();
+
+        // The swapchain can also be recreated when presenting, so compare sizes instead
+        VkExtent2D extent = swapchain_extent();
+        VkExtent2D graph_extent = render_graph_extent(&g_render_graph);
+        if (extent.width != graph_extent.width || extent.height != graph_extent.height) {
+                render_graph_resize(&g_render_graph, extent);
+        }
+
+        // The frame's previous submission has finished, so its timestamps are available
+        double gpu_time = gpu_timer_read(swapchain_current_frame_index());
+        if (gpu_time >= 0.0) {
+                g_gpu_frame_time = gpu_time;
+
+                if (g_resolution.target_ms > 0.0f) {
+                        float scale = resolution_controller_update(&g_resolution, gpu_time);
+                        render_graph_set_render_scale(&g_render_graph, scale);
+                }
+        }
+
         swapchain_current_frame_begin();
+        gpu_timer_begin(swapchain_current_frame_command_buffer(), swapchain_current_frame_index());
+}
 
-        draw_buffers_clear();
+void renderer_wait_frame() { frame_pacing_wait(); }
+
+double renderer_gpu_frame_time() { return g_gpu_frame_time; }
+
+frame_pacing_stats_t renderer_frame_pacing() { return frame_pacing_stats(); }
+
+uint32_t renderer_pass_timings(render_pass_timing_t *timings) {
+        return render_graph_pass_timings(&g_render_graph, timings);
 }
@@ -0,0 +1,55 @@
+#include "renderer/resolution.h"
+
+#include <math.h>
+
+// Weight of the newest sample in the average
+#define RESOLUTION_SMOOTHING 0.1
+// Frames to wait after a change, timestamps lag behind by the frames in flight
+#define RESOLUTION_SETTLE_FRAMES 16
+// Scales are kept on a grid so noise in the timings doesn't change the resolution every time
+#define RESOLUTION_STEP 0.05f
+// Fraction of the target the average may fall to before the scale goes up again
+#define RESOLUTION_BAND 0.85
+
+resolution_controller_t resolution_controller_create(float target_ms, float min_scale,
+                                                     float max_scale) {
+        return (resolution_controller_t){
+            .target_ms = target_ms,
+            .min_scale = min_scale,
+            .max_scale = max_scale,
+            .scale = max_scale,
+        };
+}
+
+float resolution_controller_update(resolution_controller_t *c, double gpu_ms) {
+        if (gpu_ms <= 0.0) {
+                return c->scale;
+        }
+
+        c->average_ms = c->average_ms > 0.0
+                            ? c->average_ms + (gpu_ms - c->average_ms) * RESOLUTION_SMOOTHING
+                            : gpu_ms;
+
+        if (++c->frames_since_change < RESOLUTION_SETTLE_FRAMES) {
+                return c->scale;
+        }
+        if (c->average_ms <= c->target_ms && c->average_ms >= c->target_ms * RESOLUTION_BAND) {
+                return c->scale;
+        }
+
+        // Aim for the middle of the band
+        double goal = c->target_ms * (1.0 + RESOLUTION_BAND) * 0.5;
+        float scale = c->scale * (float)sqrt(goal / c->average_ms);
+        scale = roundf(scale / RESOLUTION_STEP) * RESOLUTION_STEP;
+        // Rounding can reach zero when min_scale is below a step, which would be an empty image
+        scale = fminf(fmaxf(scale, fmaxf(c->min_scale, RESOLUTION_STEP)), c->max_scale);
+
+        if (scale != c->scale) {
+                // Estimate the time at the new scale instead of waiting for the average to adapt
+                c->average_ms *= (scale * scale) / (c->scale * c->scale);
+                c->scale = scale;
+                c->frames_since_change = 0;
+        }
+
+        return c->scale;
+}
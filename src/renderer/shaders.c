@@ -0,0 +1,73 @@
+#include "renderer/shaders.h"
+
+#include "common/util.h"
+
+#include "husky.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Generated by CMake: includes the hexembed output for every shader and defines
+// SHADER_REGISTRY(X), which expands X(name, variable) once per shader
+#include "shader_registry.h"
+
+#define SHADER_ENTRY(name, variable) {name, variable##_file, variable##_size},
+
+typedef struct shader_entry {
+        const char *name;
+        const uint8_t *code;
+        size_t size;
+} shader_entry_t;
+
+static const shader_entry_t g_shaders[] = {SHADER_REGISTRY(SHADER_ENTRY)};
+
+static bool shader_load_override(const char *name, shader_code_t *shader) {
+        const char *dir = getenv(SHADER_DIR_ENV);
+        if (!dir) {
+                return false;
+        }
+
+        char path[512];
+        snprintf(path, sizeof(path), "%s/%s.spv", dir, name);
+
+        size_t size;
+        char *code = ReadFile(path, &size);
+        if (!code) {
+                return false;
+        }
+
+        DEBUG("shaders: %s loaded from %s", name, path);
+        *shader = (shader_code_t){
+            .code = (const uint32_t *)code,
+            .size = size / sizeof(uint32_t),
+            .owned = true,
+        };
+
+        return true;
+}
+
+shader_code_t shader_load(const char *name) {
+        shader_code_t shader;
+        if (shader_load_override(name, &shader)) {
+                return shader;
+        }
+
+        for (size_t i = 0; i < sizeof(g_shaders) / sizeof(g_shaders[0]); i += 1) {
+                if (strcmp(g_shaders[i].name, name) == 0) {
+                        return (shader_code_t){
+                            .code = (const uint32_t *)g_shaders[i].code,
+                            .size = g_shaders[i].size / sizeof(uint32_t),
+                        };
+                }
+        }
+
+        ERROR("shaders: no shader named %s", name);
+        exit(1);
+}
+
+void shader_release(shader_code_t *shader) {
+        if (shader->owned) {
+                free((void *)shader->code);
+        }
+        *shader = (shader_code_t){0};
+}
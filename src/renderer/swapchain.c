@@ -3,45 +3,143 @@
 #include "renderer/buffer.h"
 #include "renderer/descriptors.h"
 #include "renderer/platform.h"
+#include "renderer/timeline.h"
 #include "renderer/vk_context.h"
 #include "renderer/vkb.h"
 
+#include "common/array.h"
+
+#include <string.h>
+
 typedef struct {
         VkCommandPool pool;
         VkCommandBuffer command;
         VkSemaphore swapchain_semaphore;
-        VkSemaphore render_semaphore;
-        VkFence render_fence;
+        uint64_t timeline_value; // reached once the frame's last submission has finished
+} frame_t;
 
+// Per-frame data lives in one buffer per kind, with a region for every frame in flight. The
+// global set is written once and each frame binds it at its own dynamic offsets.
+typedef struct frame_data {
         buffer_t camera_uniform;
         buffer_t instance_buffer;
+        buffer_t light_buffer;
+        VkDeviceSize camera_stride;
+        VkDeviceSize instance_stride;
+        VkDeviceSize light_stride;
 
         Descriptor global_descriptors;
-        VkDescriptorSet mat_descriptors;
-} frame_t;
+} frame_data_t;
 
 typedef struct swapchain {
         frame_t *frames;
+        uint32_t frame_count;
         uint32_t current_frame_index;
+
         uint32_t image_count;
         uint32_t current_image_index;
         Image *images;
+        // One per image, a frame's semaphore could still be waited on by an earlier present of a
+        // different image
+        VkSemaphore *present_semaphores;
+
+        frame_data_t data;
 
         VkSwapchainKHR swapchain;
+        VkPresentModeKHR requested_present_mode;
+        // Headless only, backing memory of the offscreen images
+        VmaAllocation *allocations;
+
+        swapchain_retired_t **retired; // array, oldest first
 } swapchain_t;
 
 static swapchain_t g_swapchain;
 
+// Everything that is replaced when the swapchain is recreated
+typedef struct swapchain_retired {
+        VkSwapchainKHR swapchain;
+        uint32_t image_count;
+        Image *images;
+        VkSemaphore *present_semaphores;
+        VmaAllocation *allocations;
+
+        uint32_t submits_left; // until the submission whose completion frees it
+        uint64_t value;        // of that submission, zero until it is made
+} swapchain_retired_t;
+
 const static VkFormat SWAPCHAIN_FORMAT = VK_FORMAT_B8G8R8A8_UNORM;
 
 static frame_t *swapchain_current_frame();
 
 static void frame_resources_init(frame_t *f);
 static void frame_resources_destroy(frame_t *f);
+static void frame_data_init(frame_data_t *data, uint32_t frame_count);
+static void frame_data_destroy(frame_data_t *data);
 
 static void begin_command_buffer(VkCommandBuffer command);
 
-void swapchain_create() {
+// Stand-in for the swapchain when there is no surface. Frames render into offscreen images and
+// are never presented.
+static void swapchain_images_create_offscreen() {
+        VkExtent2D extent;
+        platform_get_size(&extent.width, &extent.height);
+
+        // Every frame in flight renders into its own image
+        g_swapchain.image_count = g_swapchain.frame_count;
+        g_swapchain.images = malloc(sizeof(Image) * g_swapchain.image_count);
+        g_swapchain.allocations = malloc(sizeof(VmaAllocation) * g_swapchain.image_count);
+
+        for (uint32_t i = 0; i < g_swapchain.image_count; i += 1) {
+                AllocatedImageCreateInfo create_info = {
+                    .extent = {extent.width, extent.height, 1},
+                    .format = SWAPCHAIN_FORMAT,
+                    .usage_flags = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                                   VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+                                   VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                    .memory_usage = VMA_MEMORY_USAGE_GPU_ONLY,
+                    .memory_props = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                    .aspect_flags = VK_IMAGE_ASPECT_COLOR_BIT,
+                };
+
+                AllocatedImage image;
+                allocated_image_create(&create_info, &image);
+                g_swapchain.images[i] = image.image;
+                g_swapchain.allocations[i] = image.allocation;
+        }
+}
+
+static VkPresentModeKHR swapchain_present_mode() {
+        uint32_t count;
+        vkGetPhysicalDeviceSurfacePresentModesKHR(vk_context_physical_device(),
+                                                  vk_context_surface(), &count, NULL);
+        VkPresentModeKHR *modes = malloc(sizeof(VkPresentModeKHR) * count);
+        vkGetPhysicalDeviceSurfacePresentModesKHR(vk_context_physical_device(),
+                                                  vk_context_surface(), &count, modes);
+
+        // FIFO is the only mode every surface has to support
+        VkPresentModeKHR mode = VK_PRESENT_MODE_FIFO_KHR;
+        for (uint32_t i = 0; i < count; i += 1) {
+                if (modes[i] == g_swapchain.requested_present_mode) {
+                        mode = modes[i];
+                }
+        }
+        free(modes);
+
+        if (mode != g_swapchain.requested_present_mode) {
+                INFO("present mode %s unsupported, falling back to %s",
+                     string_VkPresentModeKHR(g_swapchain.requested_present_mode),
+                     string_VkPresentModeKHR(mode));
+        }
+
+        return mode;
+}
+
+static void swapchain_images_create(VkSwapchainKHR old_swapchain) {
+        if (platform_headless()) {
+                swapchain_images_create_offscreen();
+                return;
+        }
+
         VkSurfaceCapabilitiesKHR capabilities;
         vkGetPhysicalDeviceSurfaceCapabilitiesKHR(vk_context_physical_device(),
                                                   vk_context_surface(), &capabilities);
@@ -49,11 +147,16 @@ void swapchain_create() {
         VkExtent2D extent;
         platform_get_size(&extent.width, &extent.height);
 
+        uint32_t image_count = capabilities.minImageCount + 1;
+        if (capabilities.maxImageCount && image_count > capabilities.maxImageCount) {
+                image_count = capabilities.maxImageCount;
+        }
+
         VkSwapchainCreateInfoKHR create_info = {
             .sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
             .surface = vk_context_surface(),
-            .presentMode = VK_PRESENT_MODE_FIFO_KHR,
-            .minImageCount = NUM_FRAMES,
+            .presentMode = swapchain_present_mode(),
+            .minImageCount = image_count,
             .imageFormat = SWAPCHAIN_FORMAT,
             .imageExtent = extent,
             .imageArrayLayers = 1,
@@ -63,7 +166,7 @@ void swapchain_create() {
             .imageColorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR,
             .compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
             .clipped = VK_TRUE,
-            .oldSwapchain = VK_NULL_HANDLE,
+            .oldSwapchain = old_swapchain,
         };
 
         VK_EXPECT(
@@ -79,8 +182,11 @@ void swapchain_create() {
                                 &g_swapchain.image_count, images);
 
         g_swapchain.images = malloc(sizeof(Image) * g_swapchain.image_count);
+        g_swapchain.present_semaphores = malloc(sizeof(VkSemaphore) * g_swapchain.image_count);
 
-        g_swapchain.frames = malloc(sizeof(frame_t) * g_swapchain.image_count);
+        VkSemaphoreCreateInfo semaphore_info = {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+        };
 
         for (uint32_t i = 0; i < g_swapchain.image_count; i += 1) {
                 ImageCreateInfo create_info = {
@@ -93,42 +199,162 @@ void swapchain_create() {
                 };
 
                 image_create(&create_info, &g_swapchain.images[i]);
-                frame_resources_init(&g_swapchain.frames[i]);
+                VK_EXPECT(vkCreateSemaphore(vk_context_device(), &semaphore_info, NULL,
+                                            &g_swapchain.present_semaphores[i]));
         }
 
         free(images);
 }
 
+static swapchain_retired_t *swapchain_images_detach() {
+        swapchain_retired_t *retired = malloc(sizeof(swapchain_retired_t));
+        *retired = (swapchain_retired_t){
+            .swapchain = g_swapchain.swapchain,
+            .image_count = g_swapchain.image_count,
+            .images = g_swapchain.images,
+            .present_semaphores = g_swapchain.present_semaphores,
+            .allocations = g_swapchain.allocations,
+        };
+
+        g_swapchain.swapchain = VK_NULL_HANDLE;
+        g_swapchain.image_count = 0;
+        g_swapchain.images = NULL;
+        g_swapchain.present_semaphores = NULL;
+        g_swapchain.allocations = NULL;
+
+        return retired;
+}
+
+static void swapchain_retired_destroy(swapchain_retired_t *retired) {
+        for (uint32_t i = 0; i < retired->image_count; i += 1) {
+                image_destroy(&retired->images[i], vk_context_device());
+
+                if (retired->allocations) {
+                        vmaDestroyImage(vk_memory_allocator(), retired->images[i].image,
+                                        retired->allocations[i]);
+                } else {
+                        vkDestroySemaphore(vk_context_device(), retired->present_semaphores[i],
+                                           NULL);
+                }
+        }
+
+        if (retired->swapchain) {
+                vkDestroySwapchainKHR(vk_context_device(), retired->swapchain, NULL);
+        }
+
+        free(retired->images);
+        free(retired->present_semaphores);
+        free(retired->allocations);
+        free(retired);
+}
+
+void swapchain_create(uint32_t frames_in_flight, VkPresentModeKHR present_mode) {
+        ASSERT(frames_in_flight > 0 && frames_in_flight <= MAX_FRAMES_IN_FLIGHT);
+
+        g_swapchain.requested_present_mode = present_mode;
+        g_swapchain.frame_count = frames_in_flight;
+        g_swapchain.frames = malloc(sizeof(frame_t) * g_swapchain.frame_count);
+        for (uint32_t i = 0; i < g_swapchain.frame_count; i += 1) {
+                frame_resources_init(&g_swapchain.frames[i]);
+        }
+        frame_data_init(&g_swapchain.data, g_swapchain.frame_count);
+
+        swapchain_images_create(VK_NULL_HANDLE);
+        g_swapchain.retired = array(swapchain_retired_t *);
+}
+
 void swapchain_destroy() {
-        for (uint32_t i = 0; i < g_swapchain.image_count; i += 1) {
-                image_destroy(&g_swapchain.images[i], vk_context_device());
+        for (uint32_t i = 0; i < array_length(g_swapchain.retired); i += 1) {
+                swapchain_retired_destroy(g_swapchain.retired[i]);
+        }
+        array_free(g_swapchain.retired);
+        swapchain_retired_destroy(swapchain_images_detach());
+
+        for (uint32_t i = 0; i < g_swapchain.frame_count; i += 1) {
                 frame_resources_destroy(&g_swapchain.frames[i]);
         }
-        free(g_swapchain.images);
+        frame_data_destroy(&g_swapchain.data);
         free(g_swapchain.frames);
-        vkDestroySwapchainKHR(vk_context_device(), g_swapchain.swapchain, NULL);
 }
 
+// Frame resources outlive the swapchain, only the images are replaced. The old swapchain is
+// handed to the new one and retired along with its images and present semaphores, so frames in
+// flight can still finish and present.
+//
+// Without VK_EXT_swapchain_maintenance1 nothing says when a present has been processed, so when
+// the old one can be destroyed is an assumption: once a full cycle of frames in flight has been
+// submitted after the last frame that could present to it, and the last of those has finished,
+// its presents are assumed to be done too.
 void SwapchainRecreate() {
-        vkDeviceWaitIdle(vk_context_device());
+        swapchain_retired_t *old = swapchain_images_detach();
+        swapchain_images_create(old->swapchain);
+
+        // Counted from the next submission, which may be the frame already being recorded
+        old->submits_left = g_swapchain.frame_count + 1;
+        array_append(g_swapchain.retired, old);
+}
 
-        swapchain_destroy();
-        swapchain_create();
+static void swapchain_retired_submitted(uint64_t value) {
+        for (uint32_t i = 0; i < array_length(g_swapchain.retired); i += 1) {
+                swapchain_retired_t *retired = g_swapchain.retired[i];
+                if (retired->submits_left && --retired->submits_left == 0) {
+                        retired->value = value;
+                }
+        }
+}
+
+static void swapchain_retired_collect() {
+        uint32_t done = 0;
+        while (done < array_length(g_swapchain.retired) && g_swapchain.retired[done]->value &&
+               timeline_reached(g_swapchain.retired[done]->value)) {
+                swapchain_retired_destroy(g_swapchain.retired[done]);
+                done += 1;
+        }
+
+        if (done) {
+                uint32_t count = array_length(g_swapchain.retired);
+                memmove(g_swapchain.retired, g_swapchain.retired + done,
+                        sizeof(swapchain_retired_t *) * (count - done));
+                array_header(g_swapchain.retired)->length = count - done;
+        }
+}
+
+bool swapchain_wait_submitted(uint32_t age) {
+        ASSERT(age < g_swapchain.frame_count);
+
+        uint32_t count = g_swapchain.frame_count;
+        uint32_t index = (g_swapchain.current_frame_index + count - age) % count;
+        uint64_t value = g_swapchain.frames[index].timeline_value;
+        if (timeline_reached(value)) {
+                return false;
+        }
+
+        timeline_wait(value);
+        return true;
 }
 
 bool swapchain_next_frame() {
-        uint32_t next_frame_index = (g_swapchain.current_frame_index + 1) % g_swapchain.image_count;
+        uint32_t next_frame_index = (g_swapchain.current_frame_index + 1) % g_swapchain.frame_count;
         frame_t *next = &g_swapchain.frames[next_frame_index];
-        // todo : is it ok to expect on vkWaitForFences here? If function RV
-        // represents whether or not to recreate swapchain, should you recreate if
-        // fence fails (times out) or quit?
-        VK_EXPECT(
-            vkWaitForFences(vk_context_device(), 1, &next->render_fence, VK_TRUE, 1000000000));
-        VK_EXPECT(vkResetFences(vk_context_device(), 1, &next->render_fence));
+        timeline_wait(next->timeline_value);
+        swapchain_retired_collect();
 
-        VK_EXPECT(vkAcquireNextImageKHR(vk_context_device(), g_swapchain.swapchain, 1000000000,
-                                        next->swapchain_semaphore, VK_NULL_HANDLE,
-                                        &g_swapchain.current_image_index));
+        if (platform_headless()) {
+                g_swapchain.current_image_index = next_frame_index;
+                g_swapchain.current_frame_index = next_frame_index;
+                return true;
+        }
+
+        VkResult result = vkAcquireNextImageKHR(vk_context_device(), g_swapchain.swapchain,
+                                                1000000000, next->swapchain_semaphore,
+                                                VK_NULL_HANDLE, &g_swapchain.current_image_index);
+        if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+                return false;
+        }
+        // A suboptimal swapchain still signals the semaphore, presenting reports it again
+        if (result != VK_SUBOPTIMAL_KHR) {
+                VK_EXPECT(result);
+        }
 
         g_swapchain.current_frame_index = next_frame_index;
 
@@ -143,41 +369,52 @@ void swapchain_current_frame_submit() {
             .commandBuffer = current_frame->command,
         };
 
-        VkSemaphoreSubmitInfo wait_info = {
-            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
-            .semaphore = current_frame->swapchain_semaphore,
-            .stageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-            .deviceIndex = 0,
-            .value = 1,
-        };
-
-        VkSemaphoreSubmitInfo signal_info = {
-            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
-            .semaphore = current_frame->render_semaphore,
-            .stageMask = VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT,
-            .deviceIndex = 0,
-            .value = 1,
-        };
-
         VkSubmitInfo2 submit_info = {
             .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
-            .waitSemaphoreInfoCount = 1,
-            .pWaitSemaphoreInfos = &wait_info,
-            .signalSemaphoreInfoCount = 1,
-            .pSignalSemaphoreInfos = &signal_info,
             .commandBufferInfoCount = 1,
             .pCommandBufferInfos = &command_info,
         };
 
-        VK_EXPECT(vkQueueSubmit2(vk_context_graphics_queue(), 1, &submit_info,
-                                 current_frame->render_fence));
+        // Offscreen images are never acquired or presented and have no semaphores, so there is
+        // nothing to wait for or signal
+        bool headless = platform_headless();
+
+        VkSemaphoreSubmitInfo wait_info, signal_info;
+        if (!headless) {
+                wait_info = (VkSemaphoreSubmitInfo){
+                    .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+                    .semaphore = current_frame->swapchain_semaphore,
+                    .stageMask = SWAPCHAIN_ACQUIRE_STAGE,
+                    .deviceIndex = 0,
+                    .value = 1,
+                };
+                signal_info = (VkSemaphoreSubmitInfo){
+                    .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+                    .semaphore = g_swapchain.present_semaphores[g_swapchain.current_image_index],
+                    .stageMask = VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT,
+                    .deviceIndex = 0,
+                    .value = 1,
+                };
+
+                submit_info.waitSemaphoreInfoCount = 1;
+                submit_info.pWaitSemaphoreInfos = &wait_info;
+                submit_info.signalSemaphoreInfoCount = 1;
+                submit_info.pSignalSemaphoreInfos = &signal_info;
+        }
+
+        current_frame->timeline_value = timeline_submit(&submit_info);
+        swapchain_retired_submitted(current_frame->timeline_value);
+
+        if (headless) {
+                return;
+        }
 
         VkPresentInfoKHR present_info = {
             .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
             .swapchainCount = 1,
             .pSwapchains = &g_swapchain.swapchain,
             .waitSemaphoreCount = 1,
-            .pWaitSemaphores = &current_frame->render_semaphore,
+            .pWaitSemaphores = &g_swapchain.present_semaphores[g_swapchain.current_image_index],
             .pImageIndices = &g_swapchain.current_image_index,
         };
         VkResult result = vkQueuePresentKHR(vk_context_graphics_queue(), &present_info);
@@ -192,20 +429,27 @@ void swapchain_current_frame_begin() {
         begin_command_buffer(swapchain_current_frame_command_buffer());
 }
 
-Descriptor *swapchain_current_frame_global_descriptor() {
-        frame_t *current_frame = swapchain_current_frame();
+Descriptor *swapchain_global_descriptor() { return &g_swapchain.data.global_descriptors; }
+
+void swapchain_current_frame_global_offsets(uint32_t offsets[GLOBAL_DYNAMIC_OFFSETS]) {
+        uint32_t frame = g_swapchain.current_frame_index;
 
-        return &current_frame->global_descriptors;
+        offsets[0] = (uint32_t)(g_swapchain.data.camera_stride * frame);
+        offsets[1] = (uint32_t)(g_swapchain.data.instance_stride * frame);
+        offsets[2] = (uint32_t)(g_swapchain.data.light_stride * frame);
 }
 
 void *swapchain_current_frame_get_buffer(frame_buffer_type_t buffer_type) {
-        frame_t *current_frame = swapchain_current_frame();
+        frame_data_t *data = &g_swapchain.data;
+        uint32_t frame = g_swapchain.current_frame_index;
 
         switch (buffer_type) {
         case FRAME_BUFFER_CAMERA:
-                return buffer_mmap(&current_frame->camera_uniform);
+                return (char *)buffer_mmap(&data->camera_uniform) + data->camera_stride * frame;
         case FRAME_BUFFER_INSTANCES:
-                return buffer_mmap(&current_frame->instance_buffer);
+                return (char *)buffer_mmap(&data->instance_buffer) + data->instance_stride * frame;
+        case FRAME_BUFFER_LIGHTS:
+                return (char *)buffer_mmap(&data->light_buffer) + data->light_stride * frame;
         default:
                 DEBUG("error: unknown buffer type %d", buffer_type);
                 exit(1);
@@ -215,14 +459,17 @@ void *swapchain_current_frame_get_buffer(frame_buffer_type_t buffer_type) {
 }
 
 void swapchain_current_frame_unmap_buffer(frame_buffer_type_t buffer_type) {
-        frame_t *current_frame = swapchain_current_frame();
+        frame_data_t *data = &g_swapchain.data;
 
         switch (buffer_type) {
         case FRAME_BUFFER_CAMERA:
-                buffer_munmap(&current_frame->camera_uniform);
+                buffer_munmap(&data->camera_uniform);
                 break;
         case FRAME_BUFFER_INSTANCES:
-                buffer_munmap(&current_frame->instance_buffer);
+                buffer_munmap(&data->instance_buffer);
+                break;
+        case FRAME_BUFFER_LIGHTS:
+                buffer_munmap(&data->light_buffer);
                 break;
         default:
                 DEBUG("error: unknown buffer type %d", buffer_type);
@@ -238,13 +485,14 @@ VkCommandBuffer swapchain_current_frame_command_buffer() {
 
 Image *swapchain_current_image() { return &g_swapchain.images[g_swapchain.current_image_index]; }
 
-void swapchain_descriptors_write_texture(Image *image, uint32_t arr_index, VkSampler sampler) {
-        for (int i = 0; i < g_swapchain.image_count; i += 1) {
-                Descriptor texture_descriptor = g_swapchain.frames[i].global_descriptors;
-                descriptor_write_texture(texture_descriptor, image, 2, arr_index, sampler);
-        }
+VkExtent2D swapchain_extent() {
+        VkExtent3D extent = g_swapchain.images[0].extent;
+        return (VkExtent2D){extent.width, extent.height};
 }
 
+uint32_t swapchain_current_frame_index() { return g_swapchain.current_frame_index; }
+uint32_t swapchain_frame_count() { return g_swapchain.frame_count; }
+
 static frame_t *swapchain_current_frame() {
         return &g_swapchain.frames[g_swapchain.current_frame_index];
 }
@@ -265,11 +513,7 @@ static void frame_resources_init(frame_t *f) {
         };
         VK_EXPECT(vkAllocateCommandBuffers(vk_context_device(), &alloc_info, &f->command));
 
-        VkFenceCreateInfo fence_info = {
-            .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-            .flags = VK_FENCE_CREATE_SIGNALED_BIT,
-        };
-        VK_EXPECT(vkCreateFence(vk_context_device(), &fence_info, NULL, &f->render_fence));
+        f->timeline_value = 0;
 
         VkSemaphoreCreateInfo semaphore_info = {
             .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
@@ -277,32 +521,52 @@ static void frame_resources_init(frame_t *f) {
         };
         VK_EXPECT(
             vkCreateSemaphore(vk_context_device(), &semaphore_info, NULL, &f->swapchain_semaphore));
-        VK_EXPECT(
-            vkCreateSemaphore(vk_context_device(), &semaphore_info, NULL, &f->render_semaphore));
-
-        buffer_create(sizeof(SceneData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-                      VMA_MEMORY_USAGE_CPU_TO_GPU, &f->camera_uniform);
-        buffer_create(sizeof(Instance) * MAX_INSTANCES, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-                      VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, &f->instance_buffer);
-
-        f->global_descriptors = descriptor_allocate(global_descriptor_layout());
-
-        descriptor_write_buffer(f->global_descriptors, &f->camera_uniform, 0, 0);
-        descriptor_write_buffer(f->global_descriptors, &f->instance_buffer, 1, 0);
 }
 
 static void frame_resources_destroy(frame_t *f) {
         vkDestroySemaphore(vk_context_device(), f->swapchain_semaphore, NULL);
-        vkDestroySemaphore(vk_context_device(), f->render_semaphore, NULL);
-
-        vkDestroyFence(vk_context_device(), f->render_fence, NULL);
 
         vkDestroyCommandPool(vk_context_device(), f->pool, NULL);
+}
+
+static VkDeviceSize align_up(VkDeviceSize size, VkDeviceSize alignment) {
+        return (size + alignment - 1) & ~(alignment - 1);
+}
+
+static void frame_data_init(frame_data_t *data, uint32_t frame_count) {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(vk_context_physical_device(), &properties);
+        VkPhysicalDeviceLimits *limits = &properties.limits;
+
+        data->camera_stride = align_up(sizeof(SceneData), limits->minUniformBufferOffsetAlignment);
+        data->instance_stride =
+            align_up(sizeof(Instance) * MAX_INSTANCES, limits->minStorageBufferOffsetAlignment);
+        data->light_stride = align_up(sizeof(LightData), limits->minStorageBufferOffsetAlignment);
+
+        buffer_create(data->camera_stride * frame_count, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                      VMA_MEMORY_USAGE_CPU_TO_GPU, &data->camera_uniform);
+        buffer_create(data->instance_stride * frame_count, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                      VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, &data->instance_buffer);
+        buffer_create(data->light_stride * frame_count, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                      VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE, &data->light_buffer);
+
+        data->global_descriptors = descriptor_allocate(global_descriptor_layout());
+
+        // Each binding covers one frame's region, the dynamic offset selects which
+        descriptor_write_buffer_range(data->global_descriptors, &data->camera_uniform, 0, 0,
+                                      sizeof(SceneData));
+        descriptor_write_buffer_range(data->global_descriptors, &data->instance_buffer, 1, 0,
+                                      sizeof(Instance) * MAX_INSTANCES);
+        descriptor_write_buffer_range(data->global_descriptors, &data->light_buffer, 3, 0,
+                                      sizeof(LightData));
+}
 
-        descriptor_free(&f->global_descriptors);
+static void frame_data_destroy(frame_data_t *data) {
+        descriptor_free(&data->global_descriptors);
 
-        buffer_destroy(&f->camera_uniform);
-        buffer_destroy(&f->instance_buffer);
+        buffer_destroy(&data->camera_uniform);
+        buffer_destroy(&data->instance_buffer);
+        buffer_destroy(&data->light_buffer);
 }
 
 static void begin_command_buffer(VkCommandBuffer command) {
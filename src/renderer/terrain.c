@@ -0,0 +1,391 @@
+#include "renderer/terrain.h"
+
+#include "renderer/buffer.h"
+#include "renderer/camera.h"
+#include "renderer/command.h"
+#include "renderer/gpu_model.h"
+#include "renderer/model.h"
+#include "renderer/vk_context.h"
+
+#include "common/array.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SQRT_3 1.7320508f
+
+// Height of a tile at elevation zero, so that oceans still have a visible top face
+#define TERRAIN_BASE_HEIGHT 0.1f
+
+typedef struct terrain_chunk {
+        vec3 aabb[2];
+
+        bool dirty;
+        bool visible;
+} terrain_chunk_t;
+
+typedef struct terrain {
+        uint32_t width;
+        uint32_t height;
+        uint32_t chunks_x;
+        uint32_t chunks_y;
+
+        // CPU mirror of the tile buffer. Tiles are stored chunk by chunk, so that a chunk is one
+        // contiguous range of instances.
+        terrain_tile_t *tiles;
+        terrain_chunk_t *chunks;
+        uint32_t visible_chunks;
+        uint32_t view_mask;
+
+        uint32_t hex_mesh;
+        buffer_t tile_buffer;
+        VkDeviceAddress tile_address;
+} terrain_t;
+
+static terrain_t g_terrain;
+
+static void hex_mesh_push_triangle(mesh_t *mesh, vertex_t a, vertex_t b, vertex_t c) {
+        uint32_t first = array_length(mesh->vertices);
+
+        // Wind every triangle counter-clockwise around its normal
+        vec3 ab, ac, n;
+        glm_vec3_sub(b.position, a.position, ab);
+        glm_vec3_sub(c.position, a.position, ac);
+        glm_vec3_cross(ab, ac, n);
+
+        array_append(mesh->vertices, a);
+        if (glm_vec3_dot(n, a.normal) >= 0.0f) {
+                array_append(mesh->vertices, b);
+                array_append(mesh->vertices, c);
+        } else {
+                array_append(mesh->vertices, c);
+                array_append(mesh->vertices, b);
+        }
+
+        array_append(mesh->indices, first);
+        array_append(mesh->indices, first + 1);
+        array_append(mesh->indices, first + 2);
+}
+
+// A pointy-top hexagonal prism of unit radius, standing on y = 0 with its top face at y = 1. The
+// vertex shader scales it vertically by the tile height. Alpha of the vertex color is 1 on the rim
+// of the tile and 0 at its center, which the fragment shader uses to draw owner borders.
+static mesh_t hex_mesh_create() {
+        mesh_t mesh = {
+            .vertices = array(vertex_t),
+            .indices = array(uint32_t),
+        };
+
+        vec3 corners[6];
+        for (int i = 0; i < 6; i += 1) {
+                float angle = glm_rad(30.0f + 60.0f * i);
+                glm_vec3_copy((vec3){cosf(angle), 0.0f, sinf(angle)}, corners[i]);
+        }
+
+        vertex_t center = {
+            .position = {0.0f, 1.0f, 0.0f},
+            .normal = {0.0f, 1.0f, 0.0f},
+            .uv_x = 0.5f,
+            .uv_y = 0.5f,
+            .color = {1.0f, 1.0f, 1.0f, 0.0f},
+        };
+
+        for (int i = 0; i < 6; i += 1) {
+                float *c0 = corners[i];
+                float *c1 = corners[(i + 1) % 6];
+
+                vertex_t top0 = {
+                    .position = {c0[0], 1.0f, c0[2]},
+                    .normal = {0.0f, 1.0f, 0.0f},
+                    .uv_x = 0.5f + 0.5f * c0[0],
+                    .uv_y = 0.5f + 0.5f * c0[2],
+                    .color = {1.0f, 1.0f, 1.0f, 1.0f},
+                };
+                vertex_t top1 = {
+                    .position = {c1[0], 1.0f, c1[2]},
+                    .normal = {0.0f, 1.0f, 0.0f},
+                    .uv_x = 0.5f + 0.5f * c1[0],
+                    .uv_y = 0.5f + 0.5f * c1[2],
+                    .color = {1.0f, 1.0f, 1.0f, 1.0f},
+                };
+                hex_mesh_push_triangle(&mesh, center, top0, top1);
+
+                vec3 side_normal;
+                glm_vec3_add(c0, c1, side_normal);
+                glm_vec3_normalize(side_normal);
+
+                vertex_t side[4] = {
+                    {.position = {c0[0], 1.0f, c0[2]}, .uv_x = i / 6.0f, .uv_y = 1.0f},
+                    {.position = {c1[0], 1.0f, c1[2]}, .uv_x = (i + 1) / 6.0f, .uv_y = 1.0f},
+                    {.position = {c0[0], 0.0f, c0[2]}, .uv_x = i / 6.0f, .uv_y = 0.0f},
+                    {.position = {c1[0], 0.0f, c1[2]}, .uv_x = (i + 1) / 6.0f, .uv_y = 0.0f},
+                };
+                for (int v = 0; v < 4; v += 1) {
+                        glm_vec3_copy(side_normal, side[v].normal);
+                        glm_vec4_one(side[v].color);
+                }
+
+                hex_mesh_push_triangle(&mesh, side[0], side[1], side[2]);
+                hex_mesh_push_triangle(&mesh, side[2], side[1], side[3]);
+        }
+
+        return mesh;
+}
+
+static void chunk_update_bounds(uint32_t chunk) {
+        uint32_t cx = chunk % g_terrain.chunks_x;
+        uint32_t cy = chunk / g_terrain.chunks_x;
+
+        float max_height = 0.0f;
+        terrain_tile_t *tiles = &g_terrain.tiles[chunk * TERRAIN_CHUNK_TILES];
+        for (uint32_t i = 0; i < TERRAIN_CHUNK_TILES; i += 1) {
+                max_height = glm_max(max_height, tiles[i].height);
+        }
+
+        const float tile_width = SQRT_3 * TERRAIN_HEX_RADIUS;
+        const float row_height = 1.5f * TERRAIN_HEX_RADIUS;
+
+        uint32_t first_x = cx * TERRAIN_CHUNK_SIZE, last_x = first_x + TERRAIN_CHUNK_SIZE - 1;
+        uint32_t first_y = cy * TERRAIN_CHUNK_SIZE, last_y = first_y + TERRAIN_CHUNK_SIZE - 1;
+
+        terrain_chunk_t *c = &g_terrain.chunks[chunk];
+        c->aabb[0][0] = first_x * tile_width - TERRAIN_HEX_RADIUS;
+        c->aabb[0][1] = 0.0f;
+        c->aabb[0][2] = first_y * row_height - TERRAIN_HEX_RADIUS;
+        c->aabb[1][0] = (last_x + 0.5f) * tile_width + TERRAIN_HEX_RADIUS;
+        c->aabb[1][1] = TERRAIN_BASE_HEIGHT + max_height * TERRAIN_HEIGHT_SCALE;
+        c->aabb[1][2] = last_y * row_height + TERRAIN_HEX_RADIUS;
+}
+
+void terrain_init(uint32_t width, uint32_t height) {
+        ASSERT(width % TERRAIN_CHUNK_SIZE == 0 && height % TERRAIN_CHUNK_SIZE == 0);
+
+        g_terrain.width = width;
+        g_terrain.height = height;
+        g_terrain.chunks_x = width / TERRAIN_CHUNK_SIZE;
+        g_terrain.chunks_y = height / TERRAIN_CHUNK_SIZE;
+
+        uint32_t chunk_count = g_terrain.chunks_x * g_terrain.chunks_y;
+        g_terrain.tiles = calloc((size_t)width * height, sizeof(terrain_tile_t));
+        g_terrain.chunks = calloc(chunk_count, sizeof(terrain_chunk_t));
+        ASSERT(g_terrain.tiles && g_terrain.chunks);
+
+        for (uint32_t y = 0; y < height; y += 1) {
+                for (uint32_t x = 0; x < width; x += 1) {
+                        terrain_set_tile(x, y, 0.0f, 0, 0);
+                }
+        }
+
+        buffer_create(sizeof(terrain_tile_t) * width * height,
+                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                          VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                      VMA_MEMORY_USAGE_GPU_ONLY, &g_terrain.tile_buffer);
+
+        VkBufferDeviceAddressInfo address_info = {
+            .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO,
+            .buffer = g_terrain.tile_buffer.buffer,
+        };
+        g_terrain.tile_address = vkGetBufferDeviceAddress(vk_context_device(), &address_info);
+
+        mesh_t hex = hex_mesh_create();
+        g_terrain.hex_mesh = gpu_upload_mesh(&hex);
+        array_free(hex.vertices);
+        array_free(hex.indices);
+
+        DEBUG("terrain: %ux%u tiles in %u chunks", width, height, chunk_count);
+}
+
+void terrain_shutdown() {
+        if (!g_terrain.tiles) {
+                return;
+        }
+
+        buffer_destroy(&g_terrain.tile_buffer);
+        free(g_terrain.tiles);
+        free(g_terrain.chunks);
+
+        g_terrain = (terrain_t){0};
+}
+
+uint32_t terrain_biome_create(vec4 color) {
+        const size_t size = 4;
+        uint8_t *pixels = malloc(size * size * 4);
+
+        for (size_t i = 0; i < size * size; i += 1) {
+                for (int c = 0; c < 4; c += 1) {
+                        pixels[i * 4 + c] = (uint8_t)(glm_clamp(color[c], 0.0f, 1.0f) * 255.0f);
+                }
+        }
+
+        texture_data_t data = {
+            .pixels = (char *)pixels,
+            .width = size,
+            .height = size,
+        };
+        uint32_t texture = gpu_upload_texture(&data);
+
+        free(pixels);
+
+        return texture;
+}
+
+void terrain_set_tile(uint32_t x, uint32_t y, float height, uint32_t biome_tex,
+                      uint32_t owner_color) {
+        ASSERT(x < g_terrain.width && y < g_terrain.height);
+
+        uint32_t chunk = (y / TERRAIN_CHUNK_SIZE) * g_terrain.chunks_x + x / TERRAIN_CHUNK_SIZE;
+        uint32_t local = (y % TERRAIN_CHUNK_SIZE) * TERRAIN_CHUNK_SIZE + x % TERRAIN_CHUNK_SIZE;
+
+        g_terrain.tiles[chunk * TERRAIN_CHUNK_TILES + local] = (terrain_tile_t){
+            .height = height,
+            .biome_tex = biome_tex,
+            .owner_color = owner_color,
+            .coord = x | (y << 16),
+        };
+        g_terrain.chunks[chunk].dirty = true;
+}
+
+void terrain_tile_top(uint32_t x, uint32_t y, float height, vec3 dest) {
+        // odd-r offset layout, see shaders/terrain.vert
+        dest[0] = SQRT_3 * TERRAIN_HEX_RADIUS * (x + 0.5f * (y & 1));
+        dest[1] = TERRAIN_BASE_HEIGHT + height * TERRAIN_HEIGHT_SCALE;
+        dest[2] = 1.5f * TERRAIN_HEX_RADIUS * y;
+}
+
+static void tile_buffer_barrier(VkCommandBuffer cmd, VkPipelineStageFlags2 src_stage,
+                                VkAccessFlags2 src_access, VkPipelineStageFlags2 dst_stage,
+                                VkAccessFlags2 dst_access) {
+        VkBufferMemoryBarrier2 barrier = {
+            .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+            .srcStageMask = src_stage,
+            .srcAccessMask = src_access,
+            .dstStageMask = dst_stage,
+            .dstAccessMask = dst_access,
+            .buffer = g_terrain.tile_buffer.buffer,
+            .offset = 0,
+            .size = VK_WHOLE_SIZE,
+        };
+
+        VkDependencyInfo dependency = {
+            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+            .bufferMemoryBarrierCount = 1,
+            .pBufferMemoryBarriers = &barrier,
+        };
+
+        vkCmdPipelineBarrier2(cmd, &dependency);
+}
+
+void terrain_upload() {
+        uint32_t chunk_count = g_terrain.chunks_x * g_terrain.chunks_y;
+
+        uint32_t dirty_count = 0;
+        for (uint32_t c = 0; c < chunk_count; c += 1) {
+                dirty_count += g_terrain.chunks[c].dirty;
+        }
+
+        if (dirty_count == 0) {
+                return;
+        }
+
+        const size_t chunk_bytes = sizeof(terrain_tile_t) * TERRAIN_CHUNK_TILES;
+
+        buffer_t staging_buffer;
+        buffer_create(chunk_bytes * dirty_count, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                      VMA_MEMORY_USAGE_CPU_ONLY, &staging_buffer);
+
+        VkBufferCopy *copies = malloc(sizeof(VkBufferCopy) * dirty_count);
+        uint32_t copy_count = 0;
+
+        for (uint32_t c = 0; c < chunk_count; c += 1) {
+                if (!g_terrain.chunks[c].dirty) {
+                        continue;
+                }
+
+                vmaCopyMemoryToAllocation(vk_memory_allocator(),
+                                          &g_terrain.tiles[c * TERRAIN_CHUNK_TILES],
+                                          staging_buffer.allocation, copy_count * chunk_bytes,
+                                          chunk_bytes);
+
+                copies[copy_count] = (VkBufferCopy){
+                    .srcOffset = copy_count * chunk_bytes,
+                    .dstOffset = c * chunk_bytes,
+                    .size = chunk_bytes,
+                };
+                copy_count++;
+
+                chunk_update_bounds(c);
+                g_terrain.chunks[c].dirty = false;
+        }
+
+        // Frames still in flight may be reading the tile buffer, so wait for their vertex shaders
+        // before overwriting it. Both barriers also order against work submitted before or after
+        // this command buffer on the same queue.
+        VkCommandBuffer cmd = immediate_command_begin();
+
+        tile_buffer_barrier(cmd, VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT, 0,
+                            VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT);
+        vkCmdCopyBuffer(cmd, staging_buffer.buffer, g_terrain.tile_buffer.buffer, copy_count,
+                        copies);
+        tile_buffer_barrier(cmd, VK_PIPELINE_STAGE_2_COPY_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                            VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT,
+                            VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+
+        immediate_command_end();
+
+        buffer_destroy(&staging_buffer);
+        free(copies);
+}
+
+void terrain_cull() {
+        mat4 viewproj;
+        vec4 planes[6];
+        renderer_camera_viewproj(viewproj);
+        glm_frustum_planes(viewproj, planes);
+
+        g_terrain.visible_chunks = 0;
+        for (uint32_t c = 0; c < g_terrain.chunks_x * g_terrain.chunks_y; c += 1) {
+                terrain_chunk_t *chunk = &g_terrain.chunks[c];
+
+                chunk->visible = glm_aabb_frustum(chunk->aabb, planes);
+                g_terrain.visible_chunks += chunk->visible;
+        }
+}
+
+uint32_t terrain_visible_chunks() { return g_terrain.visible_chunks; }
+
+void terrain_set_view_mask(uint32_t mask) { g_terrain.view_mask = mask; }
+
+void terrain_record(VkCommandBuffer cmd, VkPipelineLayout layout) {
+        if (!g_terrain.tiles) {
+                return;
+        }
+
+        // Layout matches the push constant block in shaders/terrain.vert
+        struct {
+                VkDeviceAddress vertex_buffer;
+                VkDeviceAddress tile_buffer;
+                float hex_radius;
+                float height_scale;
+                float base_height;
+                uint32_t view_mask;
+        } pc = {
+            .vertex_buffer = gpu_mesh_vertex_address(g_terrain.hex_mesh),
+            .tile_buffer = g_terrain.tile_address,
+            .hex_radius = TERRAIN_HEX_RADIUS,
+            .height_scale = TERRAIN_HEIGHT_SCALE,
+            .base_height = TERRAIN_BASE_HEIGHT,
+            .view_mask = g_terrain.view_mask,
+        };
+        vkCmdPushConstants(cmd, layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(pc), &pc);
+
+        vkCmdBindIndexBuffer(cmd, gpu_mesh_index_buffer(g_terrain.hex_mesh), 0,
+                             VK_INDEX_TYPE_UINT32);
+
+        uint32_t index_count = gpu_mesh_index_count(g_terrain.hex_mesh);
+        for (uint32_t c = 0; c < g_terrain.chunks_x * g_terrain.chunks_y; c += 1) {
+                if (g_terrain.chunks[c].visible) {
+                        vkCmdDrawIndexed(cmd, index_count, TERRAIN_CHUNK_TILES, 0, 0,
+                                         c * TERRAIN_CHUNK_TILES);
+                }
+        }
+}
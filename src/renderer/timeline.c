@@ -0,0 +1,103 @@
+#include "renderer/timeline.h"
+
+#include "renderer/vk_context.h"
+
+#include <stdatomic.h>
+#include <string.h>
+
+typedef struct timeline {
+        VkSemaphore semaphore;
+
+        uint64_t submitted;             // only touched by the thread submitting
+        atomic_uint_fast64_t completed; // last value seen on the GPU, can lag behind
+} timeline_t;
+
+static timeline_t g_timeline;
+
+void timeline_init() {
+        VkSemaphoreTypeCreateInfo type_info = {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+            .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+            .initialValue = 0,
+        };
+        VkSemaphoreCreateInfo create_info = {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,
+            .pNext = &type_info,
+        };
+        VK_EXPECT(
+            vkCreateSemaphore(vk_context_device(), &create_info, NULL, &g_timeline.semaphore));
+
+        g_timeline.submitted = 0;
+        atomic_init(&g_timeline.completed, 0);
+}
+
+void timeline_shutdown() {
+        vkDestroySemaphore(vk_context_device(), g_timeline.semaphore, NULL);
+        g_timeline.semaphore = VK_NULL_HANDLE;
+}
+
+uint64_t timeline_submit(const VkSubmitInfo2 *submit) {
+        uint32_t count = submit->signalSemaphoreInfoCount;
+        ASSERT(count < TIMELINE_MAX_SIGNALS);
+
+        uint64_t value = g_timeline.submitted + 1;
+
+        VkSemaphoreSubmitInfo signals[TIMELINE_MAX_SIGNALS];
+        if (count) {
+                memcpy(signals, submit->pSignalSemaphoreInfos, sizeof(signals[0]) * count);
+        }
+        signals[count] = (VkSemaphoreSubmitInfo){
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+            .semaphore = g_timeline.semaphore,
+            .value = value,
+            .stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT,
+        };
+
+        VkSubmitInfo2 info = *submit;
+        info.signalSemaphoreInfoCount = count + 1;
+        info.pSignalSemaphoreInfos = signals;
+        VK_EXPECT(vkQueueSubmit2(vk_context_graphics_queue(), 1, &info, VK_NULL_HANDLE));
+
+        g_timeline.submitted = value;
+        return value;
+}
+
+uint64_t timeline_submitted() { return g_timeline.submitted; }
+
+// Threads can observe values out of order, the cached one must never move backwards
+static void timeline_observe(uint64_t value) {
+        uint64_t completed = atomic_load_explicit(&g_timeline.completed, memory_order_relaxed);
+        while (completed < value &&
+               !atomic_compare_exchange_weak_explicit(&g_timeline.completed, &completed, value,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+        }
+}
+
+bool timeline_reached(uint64_t value) {
+        if (value <= atomic_load_explicit(&g_timeline.completed, memory_order_relaxed)) {
+                return true;
+        }
+
+        uint64_t completed;
+        VK_EXPECT(
+            vkGetSemaphoreCounterValue(vk_context_device(), g_timeline.semaphore, &completed));
+        timeline_observe(completed);
+
+        return value <= completed;
+}
+
+void timeline_wait(uint64_t value) {
+        if (timeline_reached(value)) {
+                return;
+        }
+
+        VkSemaphoreWaitInfo wait_info = {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+            .semaphoreCount = 1,
+            .pSemaphores = &g_timeline.semaphore,
+            .pValues = &value,
+        };
+        VK_EXPECT(vkWaitSemaphores(vk_context_device(), &wait_info, 1000000000));
+        timeline_observe(value);
+}
@@ -0,0 +1,279 @@
+#include "renderer/visibility.h"
+
+#include "renderer/buffer.h"
+#include "renderer/command.h"
+#include "renderer/image.h"
+#include "renderer/pipeline.h"
+#include "renderer/vk_context.h"
+
+#include <stdlib.h>
+
+#define WORKGROUP_SIZE 64
+
+typedef struct visibility_gpu {
+        compute_pipeline_t pipeline;
+        DescriptorLayout layout;
+        Descriptor descriptor;
+
+        uint32_t width;
+        uint32_t height;
+        AllocatedImage image;
+
+        buffer_t blocker_buffer;
+        VkDeviceAddress blocker_address;
+
+        buffer_t source_buffer;
+        VkDeviceAddress source_address;
+        uint32_t source_capacity;
+} visibility_gpu_t;
+
+static visibility_gpu_t g_visibility;
+
+static VkDeviceAddress buffer_address(buffer_t *buffer) {
+        VkBufferDeviceAddressInfo address_info = {
+            .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO,
+            .buffer = buffer->buffer,
+        };
+
+        return vkGetBufferDeviceAddress(vk_context_device(), &address_info);
+}
+
+static void visibility_image_barrier(VkCommandBuffer cmd, VkPipelineStageFlags2 src_stage,
+                                     VkAccessFlags2 src_access, VkPipelineStageFlags2 dst_stage,
+                                     VkAccessFlags2 dst_access) {
+        VkImageMemoryBarrier2 barrier = {
+            .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+            .srcStageMask = src_stage,
+            .srcAccessMask = src_access,
+            .dstStageMask = dst_stage,
+            .dstAccessMask = dst_access,
+            .oldLayout = VK_IMAGE_LAYOUT_GENERAL,
+            .newLayout = VK_IMAGE_LAYOUT_GENERAL,
+            .image = g_visibility.image.image.image,
+            .subresourceRange =
+                {
+                    .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                    .levelCount = 1,
+                    .layerCount = 1,
+                },
+        };
+
+        VkDependencyInfo dependency = {
+            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+            .imageMemoryBarrierCount = 1,
+            .pImageMemoryBarriers = &barrier,
+        };
+
+        vkCmdPipelineBarrier2(cmd, &dependency);
+}
+
+void visibility_gpu_init() {
+        DescriptorBinding bindings[1] = {
+            {.type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+             .count = 1,
+             .stage = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT},
+        };
+
+        // Budgeted by the descriptor pool, see pass_descriptors_reserve()
+        g_visibility.layout = descriptor_layout_create(vk_context_device(), bindings, 1);
+        g_visibility.descriptor = descriptor_allocate(&g_visibility.layout);
+
+        // Layout matches the push constant block in shaders/visibility.comp
+        uint32_t sizes[] = {32};
+        comnpute_pipeline_config_t pipeline_info = {
+            .descriptors = &g_visibility.layout.layout,
+            .num_descriptors = 1,
+            .push_constant_sizes = sizes,
+            .num_push_constant_sizes = 1,
+        };
+        pipeline_queue_compute(&pipeline_info, "visibility.comp", &g_visibility.pipeline);
+}
+
+static void visibility_gpu_release_map() {
+        if (!g_visibility.width) {
+                return;
+        }
+
+        allocated_image_destroy(&g_visibility.image, vk_context_device());
+        buffer_destroy(&g_visibility.blocker_buffer);
+        g_visibility.width = 0;
+        g_visibility.height = 0;
+}
+
+void visibility_gpu_shutdown() {
+        visibility_gpu_release_map();
+        if (g_visibility.source_capacity) {
+                buffer_destroy(&g_visibility.source_buffer);
+        }
+
+        compute_pipeline_destroy(&g_visibility.pipeline, vk_context_device());
+        descriptor_layout_destroy(&g_visibility.layout);
+
+        g_visibility = (visibility_gpu_t){0};
+}
+
+void visibility_gpu_set_map(uint32_t width, uint32_t height, const uint32_t *blockers) {
+        visibility_gpu_release_map();
+
+        g_visibility.width = width;
+        g_visibility.height = height;
+
+        AllocatedImageCreateInfo image_info = {
+            .extent = {width, height, 1},
+            .format = VK_FORMAT_R32_UINT,
+            .usage_flags = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+                           VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+            .memory_usage = VMA_MEMORY_USAGE_GPU_ONLY,
+            .memory_props = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            .aspect_flags = VK_IMAGE_ASPECT_COLOR_BIT,
+        };
+        allocated_image_create(&image_info, &g_visibility.image);
+
+        size_t blocker_size = sizeof(uint32_t) * ((width * height + 31) / 32);
+        buffer_create(blocker_size,
+                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                          VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                      VMA_MEMORY_USAGE_CPU_TO_GPU, &g_visibility.blocker_buffer);
+        vmaCopyMemoryToAllocation(vk_memory_allocator(), blockers,
+                                  g_visibility.blocker_buffer.allocation, 0, blocker_size);
+        g_visibility.blocker_address = buffer_address(&g_visibility.blocker_buffer);
+
+        // Start out with everything hidden, so the terrain never reads undefined masks
+        VkCommandBuffer cmd = immediate_command_begin();
+        image_transition(&g_visibility.image.image, cmd, VK_IMAGE_LAYOUT_GENERAL);
+
+        VkClearColorValue zero = {0};
+        VkImageSubresourceRange range = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .levelCount = 1,
+            .layerCount = 1,
+        };
+        vkCmdClearColorImage(cmd, g_visibility.image.image.image, VK_IMAGE_LAYOUT_GENERAL, &zero,
+                             1, &range);
+        visibility_image_barrier(
+            cmd, VK_PIPELINE_STAGE_2_CLEAR_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT);
+        immediate_command_end();
+
+        descriptor_write_image(g_visibility.descriptor, &g_visibility.image.image, 0, 0);
+}
+
+static void source_buffer_reserve(uint32_t count) {
+        if (count <= g_visibility.source_capacity) {
+                return;
+        }
+
+        // Only the compute dispatch reads it, and immediate_command_end has waited for that
+        if (g_visibility.source_capacity) {
+                buffer_destroy(&g_visibility.source_buffer);
+        }
+
+        uint32_t capacity = g_visibility.source_capacity ? g_visibility.source_capacity : 64;
+        while (capacity < count) {
+                capacity *= 2;
+        }
+
+        buffer_create(sizeof(visibility_source_t) * capacity,
+                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                          VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                      VMA_MEMORY_USAGE_CPU_TO_GPU, &g_visibility.source_buffer);
+        g_visibility.source_address = buffer_address(&g_visibility.source_buffer);
+        g_visibility.source_capacity = capacity;
+}
+
+void visibility_gpu_compute(const visibility_source_t *sources, uint32_t count) {
+        ASSERT(g_visibility.width);
+
+        if (count) {
+                source_buffer_reserve(count);
+                vmaCopyMemoryToAllocation(vk_memory_allocator(), sources,
+                                          g_visibility.source_buffer.allocation, 0,
+                                          sizeof(visibility_source_t) * count);
+        }
+
+        // Frames still in flight may be reading the masks, so the clear waits for their vertex
+        // shaders, like the terrain tile upload does.
+        VkCommandBuffer cmd = immediate_command_begin();
+
+        visibility_image_barrier(cmd, VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT, 0,
+                                 VK_PIPELINE_STAGE_2_CLEAR_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT);
+
+        VkClearColorValue zero = {0};
+        VkImageSubresourceRange range = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .levelCount = 1,
+            .layerCount = 1,
+        };
+        vkCmdClearColorImage(cmd, g_visibility.image.image.image, VK_IMAGE_LAYOUT_GENERAL, &zero,
+                             1, &range);
+
+        visibility_image_barrier(
+            cmd, VK_PIPELINE_STAGE_2_CLEAR_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+            VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+
+        if (count) {
+                vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
+                                  g_visibility.pipeline.pipeline);
+                vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
+                                        g_visibility.pipeline.layout, 0, 1,
+                                        &g_visibility.descriptor.descriptor, 0, NULL);
+
+                struct {
+                        VkDeviceAddress sources;
+                        VkDeviceAddress blockers;
+                        uint32_t width;
+                        uint32_t height;
+                        uint32_t source_count;
+                        uint32_t padding;
+                } pc = {
+                    .sources = g_visibility.source_address,
+                    .blockers = g_visibility.blocker_address,
+                    .width = g_visibility.width,
+                    .height = g_visibility.height,
+                    .source_count = count,
+                };
+                vkCmdPushConstants(cmd, g_visibility.pipeline.layout, VK_SHADER_STAGE_COMPUTE_BIT,
+                                   0, sizeof(pc), &pc);
+
+                vkCmdDispatch(cmd, (VISIBILITY_WINDOW_TILES + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE,
+                              count, 1);
+        }
+
+        visibility_image_barrier(
+            cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+            VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_COPY_BIT,
+            VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_TRANSFER_READ_BIT);
+
+        immediate_command_end();
+}
+
+void visibility_gpu_readback(uint32_t *masks) {
+        size_t size = sizeof(uint32_t) * g_visibility.width * g_visibility.height;
+
+        buffer_t readback;
+        buffer_create(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VMA_MEMORY_USAGE_GPU_TO_CPU,
+                      &readback);
+
+        VkCommandBuffer cmd = immediate_command_begin();
+
+        VkBufferImageCopy region = {
+            .imageSubresource =
+                {
+                    .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                    .layerCount = 1,
+                },
+            .imageExtent = {g_visibility.width, g_visibility.height, 1},
+        };
+        vkCmdCopyImageToBuffer(cmd, g_visibility.image.image.image, VK_IMAGE_LAYOUT_GENERAL,
+                               readback.buffer, 1, &region);
+
+        immediate_command_end();
+
+        vmaCopyAllocationToMemory(vk_memory_allocator(), readback.allocation, 0, masks, size);
+        buffer_destroy(&readback);
+}
+
+DescriptorLayout *visibility_gpu_layout() { return &g_visibility.layout; }
+
+Descriptor *visibility_gpu_descriptor() { return &g_visibility.descriptor; }
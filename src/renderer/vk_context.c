@@ -5,7 +5,7 @@
 
 #include "husky.h"
 
-#include <SDL3/SDL_vulkan.h>
+#include <stdio.h>
 
 typedef struct {
         VkInstance instance;
@@ -17,6 +17,8 @@ typedef struct {
         VkDevice device;
         uint32_t queue_family_index;
         VkQueue graphics_queue;
+
+        float timestamp_period; // nanoseconds per timestamp tick
 } vk_context_t;
 
 static vk_context_t g_context;
@@ -31,6 +33,8 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL validation_message_callback(
                 break;
         case VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT:
                 ERROR("Validation Error: %s", pCallbackData->pMessage);
+                // Often followed by a crash, make sure the message gets out first
+                log_flush();
                 break;
         default:
                 DEBUG("[Validation]: %s\n", pCallbackData->pMessage);
@@ -40,7 +44,7 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL validation_message_callback(
         return VK_FALSE;
 }
 
-static void create_instance() {
+static void create_instance(bool validation) {
         const static char *APP_NAME = "Husky Engine";
 
         VkApplicationInfo app_info = {.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO,
@@ -62,7 +66,7 @@ static void create_instance() {
         };
 
         uint32_t count = 0;
-        const char *const *sdl_extensions = SDL_Vulkan_GetInstanceExtensions(&count);
+        const char *const *sdl_extensions = platform_instance_extensions(&count);
 
         printf("SDL Extensions:\n");
         for (uint32_t i = 0; i < count; i += 1) {
@@ -77,13 +81,14 @@ static void create_instance() {
 
         const char *layers[] = {"VK_LAYER_KHRONOS_validation"};
 
+        // CI machines run without the validation layers installed
         VkInstanceCreateInfo create_info = {.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
                                             .pApplicationInfo = &app_info,
-                                            .enabledExtensionCount = count + 1,
+                                            .enabledExtensionCount = count + validation,
                                             .ppEnabledExtensionNames = extensions,
-                                            .enabledLayerCount = 1,
+                                            .enabledLayerCount = validation ? 1 : 0,
                                             .ppEnabledLayerNames = layers,
-                                            .pNext = &validation_callback};
+                                            .pNext = validation ? &validation_callback : NULL};
 
         VK_EXPECT(vkCreateInstance(&create_info, NULL, &g_context.instance));
         volkLoadInstance(g_context.instance);
@@ -124,7 +129,7 @@ static bool is_gpu_suitable(VkPhysicalDevice gpu) {
         }
 
         if (!f12.bufferDeviceAddress || !f12.descriptorIndexing || !f13.dynamicRendering ||
-            !f13.synchronization2 || !f.features.robustBufferAccess ||
+            !f13.synchronization2 || !f12.timelineSemaphore || !f.features.robustBufferAccess ||
             !f12.descriptorBindingPartiallyBound || !f12.runtimeDescriptorArray) {
                 return false;
         }
@@ -136,12 +141,15 @@ static bool is_gpu_suitable(VkPhysicalDevice gpu) {
         vkGetPhysicalDeviceQueueFamilyProperties(gpu, &count, properties);
 
         for (uint32_t i = 0; i < count; i += 1) {
-                VkBool32 support;
-                VK_EXPECT(
-                    vkGetPhysicalDeviceSurfaceSupportKHR(gpu, i, g_context.surface, &support));
+                VkBool32 support = VK_TRUE;
+                if (g_context.surface) {
+                        VK_EXPECT(vkGetPhysicalDeviceSurfaceSupportKHR(gpu, i, g_context.surface,
+                                                                       &support));
+                }
 
                 if (support && properties[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
                         g_context.queue_family_index = i;
+                        g_context.timestamp_period = p.limits.timestampPeriod;
                         printf("Selected Device: %s.\n", p.deviceName);
                 }
         }
@@ -189,6 +197,7 @@ static void create_logical_device() {
             .descriptorIndexing = VK_TRUE,
             .runtimeDescriptorArray = VK_TRUE,
             .descriptorBindingPartiallyBound = VK_TRUE,
+            .timelineSemaphore = VK_TRUE,
             .descriptorBindingSampledImageUpdateAfterBind = VK_TRUE,
             .descriptorBindingVariableDescriptorCount = VK_TRUE,
             .shaderSampledImageArrayNonUniformIndexing = VK_TRUE,
@@ -208,7 +217,7 @@ static void create_logical_device() {
             .pQueueCreateInfos = &queue_info,
             .queueCreateInfoCount = 1,
             .ppEnabledExtensionNames = extensions,
-            .enabledExtensionCount = 1,
+            .enabledExtensionCount = platform_headless() ? 0 : 1,
             .pNext = &f,
         };
 
@@ -219,11 +228,17 @@ static void create_logical_device() {
                          &g_context.graphics_queue);
 }
 
-void vk_context_init() {
-        create_instance();
-        create_debug_messenger();
+void vk_context_init(bool validation) {
+        VK_EXPECT(volkInitialize());
 
-        g_context.surface = platform_create_surface(g_context.instance);
+        create_instance(validation);
+        if (validation) {
+                create_debug_messenger();
+        }
+
+        if (!platform_headless()) {
+                g_context.surface = platform_create_surface(g_context.instance);
+        }
 
         select_gpu();
         create_logical_device();
@@ -232,8 +247,13 @@ void vk_context_init() {
 void vk_context_shutdown() {
         vkDestroyDevice(g_context.device, NULL);
 
-        vkDestroySurfaceKHR(g_context.instance, g_context.surface, NULL);
-        vkDestroyDebugUtilsMessengerEXT(g_context.instance, g_context.debug_messenger, NULL);
+        if (g_context.surface) {
+                vkDestroySurfaceKHR(g_context.instance, g_context.surface, NULL);
+        }
+        if (g_context.debug_messenger) {
+                vkDestroyDebugUtilsMessengerEXT(g_context.instance, g_context.debug_messenger,
+                                                NULL);
+        }
         vkDestroyInstance(g_context.instance, NULL);
 }
 
@@ -245,3 +265,4 @@ VkPhysicalDevice vk_context_physical_device() { return g_context.physical_device
 VkDevice vk_context_device() { return g_context.device; }
 uint32_t vk_context_queue_family_index() { return g_context.queue_family_index; }
 VkQueue vk_context_graphics_queue() { return g_context.graphics_queue; }
+float vk_context_timestamp_period() { return g_context.timestamp_period; }
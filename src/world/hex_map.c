@@ -0,0 +1,97 @@
+#include "world/hex_map.h"
+
+#include "husky.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+hex_map_t hex_map_create(uint32_t width, uint32_t height) {
+        hex_map_t map = {
+            .width = width,
+            .height = height,
+            .tiles = calloc((size_t)width * height, sizeof(hex_tile_t)),
+        };
+        ASSERT(map.tiles);
+
+        for (uint32_t i = 0; i < width * height; i += 1) {
+                map.tiles[i].owner = HEX_OWNER_NONE;
+        }
+
+        return map;
+}
+
+void hex_map_destroy(hex_map_t *map) {
+        free(map->tiles);
+        map->tiles = NULL;
+}
+
+hex_tile_t *hex_map_tile(hex_map_t *map, uint32_t x, uint32_t y) {
+        ASSERT(x < map->width && y < map->height);
+
+        return &map->tiles[y * map->width + x];
+}
+
+static uint32_t hash(uint32_t x, uint32_t y, uint32_t seed) {
+        uint32_t h = seed ^ (x * 0x27d4eb2dU) ^ (y * 0x165667b1U);
+        h ^= h >> 15;
+        h *= 0x85ebca6bU;
+        h ^= h >> 13;
+        h *= 0xc2b2ae35U;
+        h ^= h >> 16;
+
+        return h;
+}
+
+// Bilinearly interpolated value noise on a lattice with the given cell size, in [0, 1).
+static float value_noise(uint32_t x, uint32_t y, uint32_t cell, uint32_t seed) {
+        uint32_t cx = x / cell, cy = y / cell;
+        float fx = (float)(x % cell) / cell;
+        float fy = (float)(y % cell) / cell;
+
+        float a = (hash(cx, cy, seed) & 0xFFFF) / 65536.0f;
+        float b = (hash(cx + 1, cy, seed) & 0xFFFF) / 65536.0f;
+        float c = (hash(cx, cy + 1, seed) & 0xFFFF) / 65536.0f;
+        float d = (hash(cx + 1, cy + 1, seed) & 0xFFFF) / 65536.0f;
+
+        float top = a + (b - a) * fx;
+        float bottom = c + (d - c) * fx;
+
+        return top + (bottom - top) * fy;
+}
+
+void hex_map_generate(hex_map_t *map, uint32_t seed) {
+        for (uint32_t y = 0; y < map->height; y += 1) {
+                float latitude = fabsf((float)y / map->height - 0.5f) * 2.0f;
+
+                for (uint32_t x = 0; x < map->width; x += 1) {
+                        float n = 0.55f * value_noise(x, y, 32, seed) +
+                                  0.30f * value_noise(x, y, 12, seed + 1) +
+                                  0.15f * value_noise(x, y, 4, seed + 2);
+
+                        hex_tile_t *tile = hex_map_tile(map, x, y);
+                        tile->owner = HEX_OWNER_NONE;
+
+                        if (n < 0.42f) {
+                                tile->height = 0;
+                                tile->biome = BIOME_OCEAN;
+                        } else if (n < 0.47f) {
+                                tile->height = 1;
+                                tile->biome = BIOME_COAST;
+                        } else if (n > 0.72f) {
+                                tile->height = 4;
+                                tile->biome = BIOME_MOUNTAIN;
+                        } else {
+                                tile->height = n > 0.6f ? 3 : 2;
+
+                                if (latitude > 0.8f) {
+                                        tile->biome = BIOME_TUNDRA;
+                                } else if (latitude < 0.2f && n < 0.55f) {
+                                        tile->biome = BIOME_DESERT;
+                                } else {
+                                        bool grass = hash(x, y, seed + 3) & 1;
+                                        tile->biome = grass ? BIOME_GRASSLAND : BIOME_PLAINS;
+                                }
+                        }
+                }
+        }
+}
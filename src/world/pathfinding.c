@@ -0,0 +1,451 @@
+#include "world/pathfinding.h"
+
+#include "common/array.h"
+#include "common/job.h"
+
+#include "husky.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Neighbor directions, in the order of path_grid_t::neighbor_offsets
+enum { DIR_E, DIR_W, DIR_NE, DIR_NW, DIR_SE, DIR_SW };
+
+static const uint8_t OPPOSITE_DIRECTION[6] = {DIR_W, DIR_E, DIR_SW, DIR_SE, DIR_NW, DIR_NE};
+
+struct path_heap_entry {
+        uint32_t f;
+        uint32_t g;
+        uint32_t cell;
+};
+
+static uint32_t padded_cell_count(const path_grid_t *grid) {
+        return grid->stride * (grid->height + 2);
+}
+
+static uint32_t tile_to_cell(const path_grid_t *grid, uint32_t tile) {
+        uint32_t x = tile % grid->width;
+        uint32_t y = tile / grid->width;
+
+        return (y + 1) * grid->stride + x + 1;
+}
+
+static uint32_t cell_to_tile(const path_grid_t *grid, uint32_t cell) {
+        uint32_t x = cell % grid->stride - 1;
+        uint32_t y = cell / grid->stride - 1;
+
+        return y * grid->width + x;
+}
+
+path_grid_t path_grid_create(uint32_t width, uint32_t height) {
+        ASSERT(width + 2 < INT16_MAX && height + 2 < INT16_MAX);
+
+        path_grid_t grid = {
+            .width = width,
+            .height = height,
+            .stride = width + 2,
+            .min_cost = 1,
+        };
+
+        uint32_t cells = padded_cell_count(&grid);
+        grid.costs = malloc(cells);
+        grid.axial_q = malloc(cells * sizeof(int16_t));
+        grid.axial_r = malloc(cells * sizeof(int16_t));
+        ASSERT(grid.costs && grid.axial_q && grid.axial_r);
+
+        memset(grid.costs, PATH_COST_IMPASSABLE, cells);
+
+        for (uint32_t py = 0; py < height + 2; py += 1) {
+                for (uint32_t px = 0; px < width + 2; px += 1) {
+                        int32_t x = (int32_t)px - 1;
+                        int32_t y = (int32_t)py - 1;
+                        uint32_t cell = py * grid.stride + px;
+
+                        // odd-r offset to axial coordinates
+                        grid.axial_q[cell] = (int16_t)(x - (y - (y & 1)) / 2);
+                        grid.axial_r[cell] = (int16_t)y;
+
+                        if (px > 0 && px <= width && py > 0 && py <= height) {
+                                grid.costs[cell] = 1;
+                        }
+                }
+        }
+
+        int32_t s = (int32_t)grid.stride;
+        const int32_t even[6] = {
+            [DIR_E] = 1,
+            [DIR_W] = -1,
+            [DIR_NE] = -s,
+            [DIR_NW] = -s - 1,
+            [DIR_SE] = s,
+            [DIR_SW] = s - 1,
+        };
+        const int32_t odd[6] = {
+            [DIR_E] = 1,
+            [DIR_W] = -1,
+            [DIR_NE] = -s + 1,
+            [DIR_NW] = -s,
+            [DIR_SE] = s + 1,
+            [DIR_SW] = s,
+        };
+        memcpy(grid.neighbor_offsets[0], even, sizeof(even));
+        memcpy(grid.neighbor_offsets[1], odd, sizeof(odd));
+
+        return grid;
+}
+
+void path_grid_destroy(path_grid_t *grid) {
+        free(grid->costs);
+        free(grid->axial_q);
+        free(grid->axial_r);
+}
+
+void path_grid_set_cost(path_grid_t *grid, uint32_t tile, uint8_t cost) {
+        ASSERT(tile < grid->width * grid->height);
+
+        grid->costs[tile_to_cell(grid, tile)] = cost;
+
+        // Keep the heuristic admissible
+        if (cost != PATH_COST_IMPASSABLE && cost < grid->min_cost) {
+                grid->min_cost = cost;
+        }
+}
+
+void path_grid_from_hex_map(path_grid_t *grid, const hex_map_t *map) {
+        ASSERT(grid->width == map->width && grid->height == map->height);
+
+        static const uint8_t biome_costs[BIOME_COUNT] = {
+            [BIOME_OCEAN] = PATH_COST_IMPASSABLE,
+            [BIOME_COAST] = PATH_COST_IMPASSABLE,
+            [BIOME_GRASSLAND] = 1,
+            [BIOME_PLAINS] = 1,
+            [BIOME_DESERT] = 2,
+            [BIOME_TUNDRA] = 2,
+            [BIOME_MOUNTAIN] = 3,
+        };
+
+        for (uint32_t tile = 0; tile < map->width * map->height; tile += 1) {
+                path_grid_set_cost(grid, tile, biome_costs[map->tiles[tile].biome]);
+        }
+}
+
+static uint32_t cell_distance(const path_grid_t *grid, uint32_t a, uint32_t b) {
+        int32_t dq = grid->axial_q[a] - grid->axial_q[b];
+        int32_t dr = grid->axial_r[a] - grid->axial_r[b];
+
+        return (abs(dq) + abs(dr) + abs(dq + dr)) / 2;
+}
+
+uint32_t hex_distance(const path_grid_t *grid, uint32_t a, uint32_t b) {
+        return cell_distance(grid, tile_to_cell(grid, a), tile_to_cell(grid, b));
+}
+
+///////////////////////////////////////
+/// Search Context
+///////////////////////////////////////
+
+static void path_context_reserve(path_context_t *ctx, const path_grid_t *grid) {
+        uint32_t cells = padded_cell_count(grid);
+        if (ctx->capacity >= cells) {
+                return;
+        }
+
+        free(ctx->g);
+        free(ctx->parent);
+        free(ctx->stamp);
+
+        ctx->capacity = cells;
+        ctx->g = malloc(cells * sizeof(uint32_t));
+        ctx->parent = malloc(cells * sizeof(uint32_t));
+        ctx->stamp = calloc(cells, sizeof(uint32_t));
+        ctx->generation = 0;
+        ASSERT(ctx->g && ctx->parent && ctx->stamp);
+}
+
+path_context_t path_context_create(const path_grid_t *grid) {
+        path_context_t ctx = {0};
+        path_context_reserve(&ctx, grid);
+
+        return ctx;
+}
+
+void path_context_destroy(path_context_t *ctx) {
+        free(ctx->g);
+        free(ctx->parent);
+        free(ctx->stamp);
+        free(ctx->heap);
+
+        *ctx = (path_context_t){0};
+}
+
+// Stamping visited cells with the search generation means scratch memory never has to be cleared
+// between queries.
+static void path_context_next_generation(path_context_t *ctx) {
+        ctx->generation++;
+        if (ctx->generation == 0) {
+                memset(ctx->stamp, 0, ctx->capacity * sizeof(uint32_t));
+                ctx->generation = 1;
+        }
+
+        ctx->heap_length = 0;
+}
+
+static bool heap_less(struct path_heap_entry a, struct path_heap_entry b) {
+        // Prefer deeper nodes on ties, which expands far fewer nodes on uniform cost terrain
+        return a.f < b.f || (a.f == b.f && a.g > b.g);
+}
+
+static void heap_push(path_context_t *ctx, struct path_heap_entry entry) {
+        if (ctx->heap_length == ctx->heap_capacity) {
+                ctx->heap_capacity = ctx->heap_capacity ? ctx->heap_capacity * 2 : 1024;
+                ctx->heap = realloc(ctx->heap, ctx->heap_capacity * sizeof(*ctx->heap));
+                ASSERT(ctx->heap);
+        }
+
+        uint32_t i = ctx->heap_length++;
+        while (i > 0) {
+                uint32_t parent = (i - 1) / 2;
+                if (!heap_less(entry, ctx->heap[parent])) {
+                        break;
+                }
+
+                ctx->heap[i] = ctx->heap[parent];
+                i = parent;
+        }
+        ctx->heap[i] = entry;
+}
+
+static struct path_heap_entry heap_pop(path_context_t *ctx) {
+        struct path_heap_entry top = ctx->heap[0];
+        struct path_heap_entry last = ctx->heap[--ctx->heap_length];
+
+        uint32_t i = 0;
+        for (;;) {
+                uint32_t child = 2 * i + 1;
+                if (child >= ctx->heap_length) {
+                        break;
+                }
+                if (child + 1 < ctx->heap_length &&
+                    heap_less(ctx->heap[child + 1], ctx->heap[child])) {
+                        child += 1;
+                }
+                if (!heap_less(ctx->heap[child], last)) {
+                        break;
+                }
+
+                ctx->heap[i] = ctx->heap[child];
+                i = child;
+        }
+        ctx->heap[i] = last;
+
+        return top;
+}
+
+///////////////////////////////////////
+/// A*
+///////////////////////////////////////
+
+static void path_reconstruct(path_context_t *ctx, const path_grid_t *grid, uint32_t start,
+                             uint32_t goal, uint32_t **path) {
+        array_clear(*path);
+
+        for (uint32_t cell = goal; cell != start; cell = ctx->parent[cell]) {
+                array_append(*path, cell_to_tile(grid, cell));
+        }
+        array_append(*path, cell_to_tile(grid, start));
+
+        uint32_t length = array_length(*path);
+        for (uint32_t i = 0; i < length / 2; i += 1) {
+                uint32_t tmp = (*path)[i];
+                (*path)[i] = (*path)[length - 1 - i];
+                (*path)[length - 1 - i] = tmp;
+        }
+}
+
+uint32_t path_find(path_context_t *ctx, const path_grid_t *grid, uint32_t start, uint32_t goal,
+                   uint32_t **path) {
+        path_context_reserve(ctx, grid);
+        path_context_next_generation(ctx);
+
+        uint32_t s = tile_to_cell(grid, start);
+        uint32_t t = tile_to_cell(grid, goal);
+
+        if (path) {
+                array_clear(*path);
+        }
+
+        if (grid->costs[t] == PATH_COST_IMPASSABLE) {
+                return PATH_NO_PATH;
+        }
+
+        const uint8_t *costs = grid->costs;
+        const uint32_t min_cost = grid->min_cost;
+        const uint32_t gen = ctx->generation;
+        uint32_t *g = ctx->g;
+        uint32_t *stamp = ctx->stamp;
+        uint32_t *parent = ctx->parent;
+
+        stamp[s] = gen;
+        g[s] = 0;
+        parent[s] = s;
+        heap_push(ctx, (struct path_heap_entry){cell_distance(grid, s, t) * min_cost, 0, s});
+
+        while (ctx->heap_length > 0) {
+                struct path_heap_entry e = heap_pop(ctx);
+
+                // Cells are pushed again when a cheaper route is found, skip the stale entries
+                if (e.g != g[e.cell]) {
+                        continue;
+                }
+
+                if (e.cell == t) {
+                        if (path) {
+                                path_reconstruct(ctx, grid, s, t, path);
+                        }
+                        return e.g;
+                }
+
+                const int32_t *offsets = grid->neighbor_offsets[grid->axial_r[e.cell] & 1];
+                for (int d = 0; d < 6; d += 1) {
+                        uint32_t n = e.cell + offsets[d];
+                        uint8_t cost = costs[n];
+                        if (cost == PATH_COST_IMPASSABLE) {
+                                continue;
+                        }
+
+                        uint32_t ng = e.g + cost;
+                        if (stamp[n] != gen || ng < g[n]) {
+                                stamp[n] = gen;
+                                g[n] = ng;
+                                parent[n] = e.cell;
+
+                                uint32_t f = ng + cell_distance(grid, n, t) * min_cost;
+                                heap_push(ctx, (struct path_heap_entry){f, ng, n});
+                        }
+                }
+        }
+
+        return PATH_NO_PATH;
+}
+
+///////////////////////////////////////
+/// Batched Queries
+///////////////////////////////////////
+
+typedef struct path_batch {
+        const path_grid_t *grid;
+        path_query_t *queries;
+} path_batch_t;
+
+static path_context_t *g_batch_contexts;
+static uint32_t g_batch_context_count;
+
+static void path_batch_job(void *data, uint32_t index, uint32_t worker) {
+        path_batch_t *batch = data;
+        path_query_t *q = &batch->queries[index];
+
+        q->cost = path_find(&g_batch_contexts[worker], batch->grid, q->start, q->goal,
+                            q->path ? &q->path : NULL);
+}
+
+void path_find_batch(const path_grid_t *grid, path_query_t *queries, uint32_t count) {
+        uint32_t workers = jobs_worker_count();
+        if (g_batch_context_count < workers) {
+                g_batch_contexts = realloc(g_batch_contexts, workers * sizeof(path_context_t));
+                memset(&g_batch_contexts[g_batch_context_count], 0,
+                       (workers - g_batch_context_count) * sizeof(path_context_t));
+                g_batch_context_count = workers;
+        }
+
+        path_batch_t batch = {.grid = grid, .queries = queries};
+        jobs_parallel_for(count, path_batch_job, &batch);
+}
+
+void path_batch_shutdown() {
+        for (uint32_t i = 0; i < g_batch_context_count; i += 1) {
+                path_context_destroy(&g_batch_contexts[i]);
+        }
+        free(g_batch_contexts);
+
+        g_batch_contexts = NULL;
+        g_batch_context_count = 0;
+}
+
+///////////////////////////////////////
+/// Flow Fields
+///////////////////////////////////////
+
+flow_field_t flow_field_create(const path_grid_t *grid) {
+        uint32_t cells = padded_cell_count(grid);
+        flow_field_t field = {
+            .distance = malloc(cells * sizeof(uint32_t)),
+            .direction = malloc(cells),
+        };
+        ASSERT(field.distance && field.direction);
+
+        return field;
+}
+
+void flow_field_destroy(flow_field_t *field) {
+        free(field->distance);
+        free(field->direction);
+}
+
+void flow_field_build(flow_field_t *field, path_context_t *ctx, const path_grid_t *grid,
+                      const uint32_t *goals, uint32_t goal_count) {
+        path_context_reserve(ctx, grid);
+        path_context_next_generation(ctx);
+
+        uint32_t cells = padded_cell_count(grid);
+        memset(field->distance, 0xFF, cells * sizeof(uint32_t));
+        memset(field->direction, FLOW_NO_DIRECTION, cells);
+
+        for (uint32_t i = 0; i < goal_count; i += 1) {
+                uint32_t cell = tile_to_cell(grid, goals[i]);
+                if (grid->costs[cell] != PATH_COST_IMPASSABLE) {
+                        field->distance[cell] = 0;
+                        heap_push(ctx, (struct path_heap_entry){0, 0, cell});
+                }
+        }
+
+        // Dijkstra outwards from the goals. Stepping from a neighbor into `cell` costs the cost
+        // of `cell`, so that the distances match what path_find would return.
+        while (ctx->heap_length > 0) {
+                struct path_heap_entry e = heap_pop(ctx);
+                if (e.g != field->distance[e.cell]) {
+                        continue;
+                }
+
+                uint32_t step = e.g + grid->costs[e.cell];
+                const int32_t *offsets = grid->neighbor_offsets[grid->axial_r[e.cell] & 1];
+
+                for (int d = 0; d < 6; d += 1) {
+                        uint32_t n = e.cell + offsets[d];
+                        if (grid->costs[n] == PATH_COST_IMPASSABLE || step >= field->distance[n]) {
+                                continue;
+                        }
+
+                        field->distance[n] = step;
+                        field->direction[n] = OPPOSITE_DIRECTION[d];
+                        heap_push(ctx, (struct path_heap_entry){step, step, n});
+                }
+        }
+}
+
+uint32_t flow_field_distance(const flow_field_t *field, const path_grid_t *grid, uint32_t tile) {
+        // Unreachable tiles keep their initial distance of UINT32_MAX, which is PATH_NO_PATH
+        return field->distance[tile_to_cell(grid, tile)];
+}
+
+uint32_t flow_field_next(const flow_field_t *field, const path_grid_t *grid, uint32_t tile) {
+        uint32_t cell = tile_to_cell(grid, tile);
+        uint8_t direction = field->direction[cell];
+
+        if (direction == FLOW_NO_DIRECTION) {
+                return PATH_NO_PATH;
+        }
+
+        uint32_t next = cell + grid->neighbor_offsets[grid->axial_r[cell] & 1][direction];
+
+        return cell_to_tile(grid, next);
+}
@@ -0,0 +1,332 @@
+#include "world/turn.h"
+
+#include "common/array.h"
+#include "common/job.h"
+#include "common/util.h"
+
+#include "husky.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define EXPLORE_RADIUS 6
+#define EXPLORE_ATTEMPTS 4
+
+typedef struct turn_scheduler {
+        turn_ai_t players[TURN_MAX_PLAYERS];
+
+        path_context_t *worker_paths;
+        uint32_t worker_path_count;
+
+        uint8_t *moved; // per unit, reset every turn
+} turn_scheduler_t;
+
+static turn_scheduler_t g_scheduler;
+
+static uint64_t splitmix64(uint64_t x) {
+        x += 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+
+        return x ^ (x >> 31);
+}
+
+uint32_t turn_rng_next(turn_rng_t *rng) {
+        rng->state ^= rng->state >> 12;
+        rng->state ^= rng->state << 25;
+        rng->state ^= rng->state >> 27;
+
+        return (uint32_t)((rng->state * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+static turn_rng_t turn_rng_seed(uint64_t seed, uint32_t turn, uint32_t player) {
+        uint64_t state = splitmix64(splitmix64(seed ^ turn) ^ player);
+
+        return (turn_rng_t){state ? state : 1};
+}
+
+void game_state_init(game_state_t *state, hex_map_t *map, uint32_t player_count, uint64_t seed) {
+        ASSERT(player_count <= TURN_MAX_PLAYERS);
+
+        uint32_t tile_count = map->width * map->height;
+
+        *state = (game_state_t){
+            .seed = seed,
+            .turn = 0,
+            .player_count = player_count,
+            .map = map,
+            .grid = path_grid_create(map->width, map->height),
+            .units = array(unit_t),
+            .occupant = malloc(tile_count * sizeof(uint32_t)),
+            .changed_tiles = array(uint32_t),
+        };
+
+        path_grid_from_hex_map(&state->grid, map);
+
+        for (uint32_t tile = 0; tile < tile_count; tile += 1) {
+                state->occupant[tile] = UNIT_NONE;
+        }
+}
+
+void game_state_destroy(game_state_t *state) {
+        path_grid_destroy(&state->grid);
+        array_free(state->units);
+        array_free(state->changed_tiles);
+        free(state->occupant);
+}
+
+uint32_t game_state_spawn_unit(game_state_t *state, uint32_t tile, uint8_t owner) {
+        uint32_t x = tile % state->map->width;
+        uint32_t y = tile / state->map->width;
+        uint32_t cell = (y + 1) * state->grid.stride + x + 1;
+
+        if (state->occupant[tile] != UNIT_NONE ||
+            state->grid.costs[cell] == PATH_COST_IMPASSABLE) {
+                return UNIT_NONE;
+        }
+
+        unit_t unit = {
+            .tile = tile,
+            .owner = owner,
+            .moves = 3,
+            .sight = 2,
+        };
+
+        uint32_t index = array_length(state->units);
+        array_append(state->units, unit);
+        state->occupant[tile] = index;
+
+        return index;
+}
+
+uint64_t game_state_hash(const game_state_t *state) {
+        size_t tiles_size = sizeof(hex_tile_t) * state->map->width * state->map->height;
+        size_t units_size = sizeof(unit_t) * array_length(state->units);
+
+        uint64_t h = hash_bytes(state->map->tiles, tiles_size, HASH_SEED);
+        h = hash_bytes(state->units, units_size, h);
+
+        return hash_bytes(&state->turn, sizeof(state->turn), h);
+}
+
+///////////////////////////////////////
+/// Decision Phase
+///////////////////////////////////////
+
+typedef struct turn_decision {
+        turn_ai_fn ai;
+} turn_decision_t;
+
+static void turn_decision_job(void *data, uint32_t index, uint32_t worker) {
+        turn_decision_t *decision = data;
+        turn_ai_t *ai = &g_scheduler.players[index];
+
+        // Search scratch memory belongs to the worker, everything else to the player
+        ai->path = &g_scheduler.worker_paths[worker];
+
+        decision->ai(ai);
+}
+
+static void turn_scheduler_prepare(game_state_t *state) {
+        uint32_t workers = jobs_worker_count();
+        if (g_scheduler.worker_path_count < workers) {
+                g_scheduler.worker_paths =
+                    realloc(g_scheduler.worker_paths, workers * sizeof(path_context_t));
+                memset(&g_scheduler.worker_paths[g_scheduler.worker_path_count], 0,
+                       (workers - g_scheduler.worker_path_count) * sizeof(path_context_t));
+                g_scheduler.worker_path_count = workers;
+        }
+
+        for (uint32_t p = 0; p < state->player_count; p += 1) {
+                turn_ai_t *ai = &g_scheduler.players[p];
+                if (!ai->commands) {
+                        ai->commands = array(turn_command_t);
+                        ai->path_tiles = array(uint32_t);
+                }
+
+                ai->state = state;
+                ai->player = p;
+                ai->rng = turn_rng_seed(state->seed, state->turn, p);
+                array_clear(ai->commands);
+        }
+
+        g_scheduler.moved = realloc(g_scheduler.moved, array_length(state->units) + 1);
+        memset(g_scheduler.moved, 0, array_length(state->units));
+}
+
+///////////////////////////////////////
+/// Apply Phase
+///////////////////////////////////////
+
+static bool turn_apply_move(game_state_t *state, turn_command_t *cmd) {
+        unit_t *unit = &state->units[cmd->unit];
+
+        if (g_scheduler.moved[cmd->unit] || state->occupant[cmd->tile] != UNIT_NONE) {
+                return false;
+        }
+
+        uint32_t cost =
+            path_find(&g_scheduler.worker_paths[0], &state->grid, unit->tile, cmd->tile, NULL);
+        if (cost > unit->moves) {
+                return false;
+        }
+
+        state->occupant[unit->tile] = UNIT_NONE;
+        state->occupant[cmd->tile] = cmd->unit;
+        unit->tile = cmd->tile;
+        g_scheduler.moved[cmd->unit] = 1;
+
+        return true;
+}
+
+static bool turn_apply_claim(game_state_t *state, uint32_t player, turn_command_t *cmd) {
+        unit_t *unit = &state->units[cmd->unit];
+        hex_tile_t *tile = &state->map->tiles[cmd->tile];
+
+        if (unit->tile != cmd->tile || tile->owner != HEX_OWNER_NONE) {
+                return false;
+        }
+
+        tile->owner = (uint8_t)player;
+        array_append(state->changed_tiles, cmd->tile);
+
+        return true;
+}
+
+static bool turn_apply(game_state_t *state, uint32_t player, turn_command_t *cmd) {
+        uint32_t tile_count = state->map->width * state->map->height;
+
+        if (cmd->unit >= array_length(state->units) || cmd->tile >= tile_count ||
+            state->units[cmd->unit].owner != player) {
+                return false;
+        }
+
+        switch (cmd->type) {
+        case TURN_COMMAND_MOVE:
+                return turn_apply_move(state, cmd);
+        case TURN_COMMAND_CLAIM:
+                return turn_apply_claim(state, player, cmd);
+        default:
+                DEBUG("error: unknown turn command %d", cmd->type);
+                return false;
+        }
+}
+
+void turn_process(game_state_t *state, turn_ai_fn ai) {
+        struct timespec begin, decided, end;
+        clock_gettime(CLOCK_MONOTONIC, &begin);
+
+        turn_scheduler_prepare(state);
+        array_clear(state->changed_tiles);
+
+        turn_decision_t decision = {.ai = ai};
+        jobs_parallel_for(state->player_count, turn_decision_job, &decision);
+
+        clock_gettime(CLOCK_MONOTONIC, &decided);
+
+        uint32_t applied = 0, rejected = 0;
+        for (uint32_t p = 0; p < state->player_count; p += 1) {
+                turn_ai_t *player = &g_scheduler.players[p];
+
+                for (uint32_t c = 0; c < array_length(player->commands); c += 1) {
+                        if (turn_apply(state, p, &player->commands[c])) {
+                                applied++;
+                        } else {
+                                rejected++;
+                        }
+                }
+        }
+
+        state->turn++;
+
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        double decide_ms = (decided.tv_sec - begin.tv_sec) * 1e3 +
+                           (decided.tv_nsec - begin.tv_nsec) * 1e-6;
+        double apply_ms =
+            (end.tv_sec - decided.tv_sec) * 1e3 + (end.tv_nsec - decided.tv_nsec) * 1e-6;
+        DEBUG("turn %u: %u commands applied, %u rejected, decide %.2f ms, apply %.2f ms",
+              state->turn, applied, rejected, decide_ms, apply_ms);
+        DEBUG("turn %u: state hash %016llx", state->turn,
+              (unsigned long long)game_state_hash(state));
+}
+
+void turn_shutdown() {
+        for (uint32_t p = 0; p < TURN_MAX_PLAYERS; p += 1) {
+                if (g_scheduler.players[p].commands) {
+                        array_free(g_scheduler.players[p].commands);
+                        array_free(g_scheduler.players[p].path_tiles);
+                }
+        }
+
+        for (uint32_t w = 0; w < g_scheduler.worker_path_count; w += 1) {
+                path_context_destroy(&g_scheduler.worker_paths[w]);
+        }
+        free(g_scheduler.worker_paths);
+        free(g_scheduler.moved);
+
+        g_scheduler = (turn_scheduler_t){0};
+}
+
+///////////////////////////////////////
+/// AI
+///////////////////////////////////////
+
+static int32_t explore_offset(turn_rng_t *rng) {
+        return (int32_t)(turn_rng_next(rng) % (2 * EXPLORE_RADIUS + 1)) - EXPLORE_RADIUS;
+}
+
+void turn_ai_explore(turn_ai_t *ai) {
+        const game_state_t *state = ai->state;
+        const int32_t width = state->map->width;
+        const int32_t height = state->map->height;
+
+        for (uint32_t u = 0; u < array_length(state->units); u += 1) {
+                const unit_t *unit = &state->units[u];
+                if (unit->owner != ai->player) {
+                        continue;
+                }
+
+                int32_t x = unit->tile % width;
+                int32_t y = unit->tile / width;
+
+                for (int attempt = 0; attempt < EXPLORE_ATTEMPTS; attempt += 1) {
+                        int32_t tx = x + explore_offset(&ai->rng);
+                        int32_t ty = y + explore_offset(&ai->rng);
+                        if (tx < 0 || ty < 0 || tx >= width || ty >= height) {
+                                continue;
+                        }
+
+                        uint32_t target = ty * width + tx;
+                        uint32_t cost = path_find(ai->path, &state->grid, unit->tile, target,
+                                                  &ai->path_tiles);
+                        if (cost == PATH_NO_PATH) {
+                                continue;
+                        }
+
+                        // Walk as far along the path as this turn's movement points allow
+                        uint32_t destination = unit->tile;
+                        uint32_t spent = 0;
+                        for (uint32_t i = 1; i < array_length(ai->path_tiles); i += 1) {
+                                uint32_t tile = ai->path_tiles[i];
+                                uint32_t cell = (tile / width + 1) * state->grid.stride +
+                                                tile % width + 1;
+
+                                spent += state->grid.costs[cell];
+                                if (spent > unit->moves) {
+                                        break;
+                                }
+                                destination = tile;
+                        }
+
+                        if (destination != unit->tile) {
+                                turn_command_t move = {TURN_COMMAND_MOVE, u, destination};
+                                turn_command_t claim = {TURN_COMMAND_CLAIM, u, destination};
+                                array_append(ai->commands, move);
+                                array_append(ai->commands, claim);
+                                break;
+                        }
+                }
+        }
+}
@@ -0,0 +1,186 @@
+#include "world/visibility.h"
+
+#include "husky.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Lines are sampled in cube coordinates scaled by LINE_SCALE, with a small nudge so that a sample
+// never lands exactly between two tiles. Must match shaders/visibility.comp.
+#define LINE_SCALE 8
+
+#define WINDOW_SIZE (2 * VISIBILITY_MAX_SIGHT + 1)
+
+// The tiles around a unit are numbered row by row in axial coordinates, which gives every tile in
+// the window a bit. A line mask has a bit set for every tile between the unit and the target, so a
+// target is visible when its line mask and the blocked tiles around the unit don't intersect.
+typedef struct line_mask {
+        _Alignas(16) uint64_t bits[4];
+} line_mask_t;
+
+_Static_assert(VISIBILITY_WINDOW_TILES <= 256, "line masks hold at most 256 tiles");
+
+typedef struct window_tile {
+        int8_t dq;
+        int8_t dr;
+        uint8_t distance;
+} window_tile_t;
+
+typedef struct visibility_table {
+        bool initialized;
+
+        window_tile_t tiles[VISIBILITY_WINDOW_TILES];
+        line_mask_t lines[VISIBILITY_WINDOW_TILES];
+        int16_t index[WINDOW_SIZE][WINDOW_SIZE]; // by dq, dr
+} visibility_table_t;
+
+static visibility_table_t g_table;
+
+static int32_t floor_div(int32_t a, int32_t b) { return a >= 0 ? a / b : -((-a + b - 1) / b); }
+
+static int32_t abs_i32(int32_t a) { return a < 0 ? -a : a; }
+
+// The i-th of the distance + 1 tiles on the line from the origin to (dq, dr), in axial coordinates
+static void hex_line_step(int32_t dq, int32_t dr, int32_t distance, int32_t i, int32_t *q,
+                          int32_t *r) {
+        int32_t den = distance * LINE_SCALE;
+        int32_t nq = dq * i * LINE_SCALE + 1;
+        int32_t nr = dr * i * LINE_SCALE + 2;
+        int32_t ns = (-dq - dr) * i * LINE_SCALE - 3;
+
+        int32_t rq = floor_div(2 * nq + den, 2 * den);
+        int32_t rr = floor_div(2 * nr + den, 2 * den);
+        int32_t rs = floor_div(2 * ns + den, 2 * den);
+
+        int32_t eq = abs_i32(rq * den - nq);
+        int32_t er = abs_i32(rr * den - nr);
+        int32_t es = abs_i32(rs * den - ns);
+
+        if (eq > er && eq > es) {
+                rq = -rr - rs;
+        } else if (er > es) {
+                rr = -rq - rs;
+        }
+
+        *q = rq;
+        *r = rr;
+}
+
+static void visibility_table_init() {
+        const int32_t R = VISIBILITY_MAX_SIGHT;
+
+        memset(g_table.index, 0xFF, sizeof(g_table.index));
+
+        uint32_t count = 0;
+        for (int32_t dq = -R; dq <= R; dq += 1) {
+                int32_t first = dq < 0 ? -dq - R : -R;
+                int32_t last = dq < 0 ? R : R - dq;
+
+                for (int32_t dr = first; dr <= last; dr += 1) {
+                        int32_t distance = (abs_i32(dq) + abs_i32(dr) + abs_i32(dq + dr)) / 2;
+
+                        g_table.tiles[count] = (window_tile_t){dq, dr, distance};
+                        g_table.index[dq + R][dr + R] = count;
+                        count++;
+                }
+        }
+        ASSERT(count == VISIBILITY_WINDOW_TILES);
+
+        for (uint32_t w = 0; w < VISIBILITY_WINDOW_TILES; w += 1) {
+                window_tile_t *t = &g_table.tiles[w];
+
+                for (int32_t i = 1; i < t->distance; i += 1) {
+                        int32_t q, r;
+                        hex_line_step(t->dq, t->dr, t->distance, i, &q, &r);
+
+                        uint32_t bit = g_table.index[q + R][r + R];
+                        g_table.lines[w].bits[bit / 64] |= 1ULL << (bit % 64);
+                }
+        }
+
+        g_table.initialized = true;
+}
+
+uint32_t *visibility_blockers_create(const hex_map_t *map) {
+        uint32_t tile_count = map->width * map->height;
+        uint32_t *blockers = calloc((tile_count + 31) / 32, sizeof(uint32_t));
+
+        for (uint32_t tile = 0; tile < tile_count; tile += 1) {
+                if (map->tiles[tile].biome == BIOME_MOUNTAIN) {
+                        blockers[tile / 32] |= 1u << (tile % 32);
+                }
+        }
+
+        return blockers;
+}
+
+void visibility_blockers_destroy(uint32_t *blockers) { free(blockers); }
+
+static bool line_clear(const line_mask_t *blocked, const line_mask_t *line) {
+#if defined(__SSE2__)
+        __m128i lo = _mm_and_si128(_mm_load_si128((const __m128i *)&blocked->bits[0]),
+                                   _mm_load_si128((const __m128i *)&line->bits[0]));
+        __m128i hi = _mm_and_si128(_mm_load_si128((const __m128i *)&blocked->bits[2]),
+                                   _mm_load_si128((const __m128i *)&line->bits[2]));
+        __m128i hit = _mm_or_si128(lo, hi);
+
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(hit, _mm_setzero_si128())) == 0xFFFF;
+#else
+        return ((blocked->bits[0] & line->bits[0]) | (blocked->bits[1] & line->bits[1]) |
+                (blocked->bits[2] & line->bits[2]) | (blocked->bits[3] & line->bits[3])) == 0;
+#endif
+}
+
+void visibility_compute(uint32_t width, uint32_t height, const uint32_t *blockers,
+                        const visibility_source_t *sources, uint32_t count, uint32_t *masks) {
+        if (!g_table.initialized) {
+                visibility_table_init();
+        }
+
+        memset(masks, 0, sizeof(uint32_t) * width * height);
+
+        // Target tile of every window entry, or UINT32_MAX when it falls outside the map
+        uint32_t targets[VISIBILITY_WINDOW_TILES];
+
+        for (uint32_t s = 0; s < count; s += 1) {
+                const visibility_source_t *source = &sources[s];
+                ASSERT(source->sight <= VISIBILITY_MAX_SIGHT && source->owner < 32);
+
+                // odd-r offset to axial
+                int32_t sq = source->x - (source->y - (source->y & 1)) / 2;
+                int32_t sr = source->y;
+
+                line_mask_t blocked = {0};
+                for (uint32_t w = 0; w < VISIBILITY_WINDOW_TILES; w += 1) {
+                        int32_t y = sr + g_table.tiles[w].dr;
+                        int32_t x = sq + g_table.tiles[w].dq + (y - (y & 1)) / 2;
+
+                        if (x < 0 || y < 0 || x >= (int32_t)width || y >= (int32_t)height) {
+                                targets[w] = UINT32_MAX;
+                                continue;
+                        }
+
+                        uint32_t tile = y * width + x;
+                        targets[w] = tile;
+
+                        if (blockers[tile / 32] & (1u << (tile % 32))) {
+                                blocked.bits[w / 64] |= 1ULL << (w % 64);
+                        }
+                }
+
+                uint32_t bit = 1u << source->owner;
+                for (uint32_t w = 0; w < VISIBILITY_WINDOW_TILES; w += 1) {
+                        if (targets[w] == UINT32_MAX || g_table.tiles[w].distance > source->sight) {
+                                continue;
+                        }
+
+                        if (line_clear(&blocked, &g_table.lines[w])) {
+                                masks[targets[w]] |= bit;
+                        }
+                }
+        }
+}
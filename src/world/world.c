@@ -1,13 +1,51 @@
 #include "world/world.h"
 
+#include "world/hex_map.h"
+#include "world/turn.h"
+#include "world/visibility.h"
+
+#include "common/array.h"
+#include "common/profiler.h"
+
 #include "renderer/camera.h"
 #include "renderer/renderer.h"
+#include "renderer/terrain.h"
+#include "renderer/visibility.h"
+
+#include "husky.h"
 
 #include <SDL3/SDL.h>
 #include <cglm/cglm.h>
 #include <flecs.h>
+#include <stdlib.h>
+
+#define MAP_WIDTH 256
+#define MAP_HEIGHT 256
+#define MAP_SEED 1337
+
+#define PLAYER_COUNT 4
+#define UNITS_PER_PLAYER 8
+// Player whose view of the map is rendered
+#define LOCAL_PLAYER 0
 
 static ecs_world_t *ecs;
+static hex_map_t g_map;
+static game_state_t g_game;
+
+static uint32_t *g_blockers;
+static uint32_t *g_visibility; // player bitmask per tile
+static visibility_source_t *g_sources;
+
+static bool g_camera_path;
+static uint32_t g_camera_frame;
+
+static uint32_t g_biome_textures[BIOME_COUNT];
+static const uint32_t g_owner_colors[] = {0xFF2020E0, 0xFFE02020, 0xFF20C020, 0xFF20E0E0};
+
+// Every unit carries a torch in its owner's color
+#define UNIT_LIGHT_HEIGHT 1.0f
+#define UNIT_LIGHT_RADIUS 6.0f
+#define UNIT_LIGHT_INTENSITY 8.0f
 
 typedef struct position {
         vec3 position;
@@ -54,10 +92,36 @@ static void set_camera(ecs_iter_t *it) {
         renderer_set_camera(camera);
 }
 
+// Circles the middle of the map, always looking at its center
+static void camera_path(position_t *p, camera_target_t *t) {
+        const float radius = 40.0f;
+        const float height = 25.0f;
+        const float frames_per_orbit = 600.0f;
+
+        float angle = GLM_PIf * 2.0f * g_camera_frame / frames_per_orbit;
+        vec3 center = {g_map.width * 0.866f, 0.0f, g_map.height * 0.75f};
+
+        glm_vec3_copy((vec3){center[0] + radius * cosf(angle), height,
+                             center[2] + radius * sinf(angle)},
+                      p->position);
+
+        glm_vec3_sub(center, p->position, t->target);
+        glm_vec3_normalize(t->target);
+
+        g_camera_frame++;
+}
+
 static void move(ecs_iter_t *it) {
         position_t *p = ecs_field(it, position_t, 0);
         camera_target_t *t = ecs_field(it, camera_target_t, 1);
 
+        if (g_camera_path) {
+                for (int i = 0; i < it->count; i++) {
+                        camera_path(&p[i], &t[i]);
+                }
+                return;
+        }
+
         for (int i = 0; i < it->count; i++) {
                 const bool *keys = SDL_GetKeyboardState(NULL);
                 const float camera_speed = 0.02f;
@@ -99,8 +163,138 @@ static void move(ecs_iter_t *it) {
         }
 }
 
+static void terrain_sync_tile(uint32_t x, uint32_t y) {
+        hex_tile_t *tile = hex_map_tile(&g_map, x, y);
+        uint32_t owner =
+            tile->owner == HEX_OWNER_NONE ? 0 : g_owner_colors[tile->owner % PLAYER_COUNT];
+
+        terrain_set_tile(x, y, tile->height, g_biome_textures[tile->biome], owner);
+}
+
+static void map_init() {
+        g_map = hex_map_create(MAP_WIDTH, MAP_HEIGHT);
+        hex_map_generate(&g_map, MAP_SEED);
+
+        vec4 biome_colors[BIOME_COUNT] = {
+            [BIOME_OCEAN] = {0.10f, 0.25f, 0.60f, 1.0f},
+            [BIOME_COAST] = {0.25f, 0.55f, 0.75f, 1.0f},
+            [BIOME_GRASSLAND] = {0.30f, 0.60f, 0.20f, 1.0f},
+            [BIOME_PLAINS] = {0.60f, 0.65f, 0.30f, 1.0f},
+            [BIOME_DESERT] = {0.90f, 0.80f, 0.50f, 1.0f},
+            [BIOME_TUNDRA] = {0.75f, 0.80f, 0.80f, 1.0f},
+            [BIOME_MOUNTAIN] = {0.45f, 0.40f, 0.40f, 1.0f},
+        };
+
+        for (int b = 0; b < BIOME_COUNT; b += 1) {
+                g_biome_textures[b] = terrain_biome_create(biome_colors[b]);
+        }
+
+        terrain_init(g_map.width, g_map.height);
+        for (uint32_t y = 0; y < g_map.height; y += 1) {
+                for (uint32_t x = 0; x < g_map.width; x += 1) {
+                        terrain_sync_tile(x, y);
+                }
+        }
+}
+
+static void players_init() {
+        game_state_init(&g_game, &g_map, PLAYER_COUNT, MAP_SEED);
+
+        // Spawning draws from the same seeded generator as the AI so replays start identically
+        turn_rng_t rng = {MAP_SEED};
+        for (uint8_t player = 0; player < PLAYER_COUNT; player += 1) {
+                uint32_t spawned = 0;
+                while (spawned < UNITS_PER_PLAYER) {
+                        uint32_t tile = turn_rng_next(&rng) % (g_map.width * g_map.height);
+                        spawned += game_state_spawn_unit(&g_game, tile, player) != UNIT_NONE;
+                }
+        }
+}
+
+static void visibility_update() {
+        array_clear(g_sources);
+        for (uint32_t u = 0; u < array_length(g_game.units); u += 1) {
+                unit_t *unit = &g_game.units[u];
+                visibility_source_t source = {
+                    .x = unit->tile % g_map.width,
+                    .y = unit->tile / g_map.width,
+                    .owner = unit->owner,
+                    .sight = unit->sight,
+                };
+                array_append(g_sources, source);
+        }
+
+        visibility_compute(g_map.width, g_map.height, g_blockers, g_sources,
+                           array_length(g_sources), g_visibility);
+        visibility_gpu_compute(g_sources, array_length(g_sources));
+
+#ifdef HUSKY_CHECK_VISIBILITY
+        // Both implementations must agree bit for bit. Reading the map back stalls the GPU, so
+        // this is only done when asked for.
+        uint32_t tile_count = g_map.width * g_map.height;
+        uint32_t *gpu = malloc(sizeof(uint32_t) * tile_count);
+        ASSERT(gpu);
+        visibility_gpu_readback(gpu);
+
+        uint32_t mismatches = 0;
+        for (uint32_t tile = 0; tile < tile_count; tile += 1) {
+                mismatches += gpu[tile] != g_visibility[tile];
+        }
+        if (mismatches) {
+                ERROR("visibility differs between CPU and GPU on %u tiles", mismatches);
+        }
+        free(gpu);
+#endif
+}
+
+static void visibility_init() {
+        g_blockers = visibility_blockers_create(&g_map);
+        g_visibility = malloc(sizeof(uint32_t) * g_map.width * g_map.height);
+        g_sources = array(visibility_source_t);
+
+        visibility_gpu_set_map(g_map.width, g_map.height, g_blockers);
+        visibility_update();
+
+        terrain_set_view_mask(1u << LOCAL_PLAYER);
+}
+
+static void unit_lights_record() {
+        for (uint32_t u = 0; u < array_length(g_game.units); u += 1) {
+                unit_t *unit = &g_game.units[u];
+                uint32_t x = unit->tile % g_map.width;
+                uint32_t y = unit->tile / g_map.width;
+
+                vec3 position;
+                terrain_tile_top(x, y, hex_map_tile(&g_map, x, y)->height, position);
+                position[1] += UNIT_LIGHT_HEIGHT;
+
+                // Owner colors are packed RGBA8, red in the lowest byte
+                uint32_t packed = g_owner_colors[unit->owner % PLAYER_COUNT];
+                vec3 color = {(packed & 0xFF) / 255.0f, ((packed >> 8) & 0xFF) / 255.0f,
+                              ((packed >> 16) & 0xFF) / 255.0f};
+
+                point_light_record(position, UNIT_LIGHT_RADIUS, color, UNIT_LIGHT_INTENSITY);
+        }
+}
+
+void world_end_turn() {
+        PROFILE_ZONE("world_end_turn");
+
+        turn_process(&g_game, turn_ai_explore);
+
+        for (uint32_t i = 0; i < array_length(g_game.changed_tiles); i += 1) {
+                uint32_t tile = g_game.changed_tiles[i];
+                terrain_sync_tile(tile % g_map.width, tile / g_map.width);
+        }
+
+        visibility_update();
+}
+
 void world_init() {
         GpuModel model = renderer_load_model("assets/Sponza/glTF/Sponza.gltf");
+        map_init();
+        players_init();
+        visibility_init();
 
         ecs = ecs_init();
         ECS_COMPONENT(ecs, position_t);
@@ -124,6 +318,25 @@ void world_init() {
         ecs_set(ecs, sponza, model_component_t, {model});
 }
 
-void world_progress() { ecs_progress(ecs, 0.016f); }
+void world_set_camera_path(bool enabled) {
+        g_camera_path = enabled;
+        g_camera_frame = 0;
+}
+
+void world_progress() {
+        PROFILE_ZONE("world_progress");
 
-void world_shutdown() { ecs_fini(ecs); }
+        ecs_progress(ecs, 0.016f);
+
+        unit_lights_record();
+}
+
+void world_shutdown() {
+        ecs_fini(ecs);
+        turn_shutdown();
+        visibility_blockers_destroy(g_blockers);
+        array_free(g_sources);
+        free(g_visibility);
+        game_state_destroy(&g_game);
+        hex_map_destroy(&g_map);
+}
@@ -0,0 +1,70 @@
+/**
+ * Submits many small batches back to back and checks that every index of every batch runs exactly
+ * once. Small batches finish before the workers have all woken up, so late workers race the next
+ * submission.
+ *
+ * Usage: job-stress [batches] [threads]
+ */
+#include "common/job.h"
+
+#include "husky.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MAX_BATCH_SIZE 64
+
+typedef struct stress_batch {
+        atomic_uint runs[MAX_BATCH_SIZE];
+        uint32_t count;
+} stress_batch_t;
+
+static void stress_job(void *data, uint32_t index, uint32_t worker) {
+        stress_batch_t *batch = data;
+        ASSERT(index < batch->count);
+        ASSERT(worker < jobs_worker_count());
+
+        atomic_fetch_add(&batch->runs[index], 1);
+}
+
+int main(int argc, char **argv) {
+        uint32_t batch_count = argc > 1 ? (uint32_t)atoi(argv[1]) : 200000;
+        uint32_t threads = argc > 2 ? (uint32_t)atoi(argv[2]) : 0;
+
+        jobs_init(threads);
+
+        // Two batches alternate, so a late worker still holding the previous one would write into
+        // memory the current batch is checked against
+        stress_batch_t *batches = calloc(2, sizeof(stress_batch_t));
+        ASSERT(batches);
+
+        uint32_t failures = 0;
+        for (uint32_t b = 0; b < batch_count; b += 1) {
+                stress_batch_t *batch = &batches[b % 2];
+                batch->count = 2 + b % (MAX_BATCH_SIZE - 1);
+                for (uint32_t i = 0; i < MAX_BATCH_SIZE; i += 1) {
+                        atomic_store(&batch->runs[i], 0);
+                }
+
+                jobs_parallel_for(batch->count, stress_job, batch);
+
+                for (uint32_t i = 0; i < MAX_BATCH_SIZE; i += 1) {
+                        uint32_t expected = i < batch->count ? 1 : 0;
+                        uint32_t runs = atomic_load(&batch->runs[i]);
+                        if (runs != expected) {
+                                printf("batch %u: index %u ran %u times, expected %u\n", b, i,
+                                       runs, expected);
+                                failures += 1;
+                        }
+                }
+        }
+
+        printf("%u batches on %u workers, %u failures\n", batch_count, jobs_worker_count(),
+               failures);
+
+        free(batches);
+        jobs_shutdown();
+
+        return failures ? 1 : 0;
+}